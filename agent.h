@@ -16,8 +16,43 @@
 #include <algorithm>
 #include "board.h"
 #include "action.h"
+#include "mcts.h"
+#include "solver.h"
+#include "book.h"
+#include "cancel.h"
+#include "alphabeta.h"
 #include <fstream>
 #include <queue>
+#include <array>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+
+/**
+ * the counters of the last search of an agent, which are recorded with its move in the episode
+ */
+struct search_info {
+	uint32_t iterations; // the iterations of the search, or the completed depths of iterative deepening
+	uint32_t playouts;   // the simulated games
+	uint32_t nodes;      // the allocated or searched nodes
+	uint16_t depth;      // the maximum depth reached
+	int8_t result;       // 1 if the position is proven to win, -1 if proven to lose, or 0 if unknown
+};
+
+/**
+ * the statistics of a root child of a search, which are reported to a watcher of the search (see agent::report)
+ */
+struct root_report {
+	int move;
+	int visits;
+	float winrate;       // for the side to move
+	float amaf;          // the all-moves-as-first (RAVE) win rate of the move
+	int proof;           // see mcts_tree::proof_type
+	std::vector<int> pv; // the principal variation starting with the move
+};
 
 class agent {
 public:
@@ -33,7 +68,29 @@ public:
 	virtual void open_episode(const std::string& flag = "") {}
 	virtual void close_episode(const std::string& flag = "") {}
 	virtual action take_action(const board& b) { return action(); }
-	virtual bool check_for_win(const board& b) { return false; }
+	/**
+	 * whether the last move has won, i.e., the side to move of the board has no legal move
+	 */
+	virtual bool check_for_win(const board& b) { return !b.has_legal_move(b.info().who_take_turns); }
+	/**
+	 * the counters of the search of the last move, see search_info
+	 */
+	virtual search_info last_search() const { return {}; }
+	/**
+	 * request the running take_action to return its best move so far as soon as possible,
+	 * which may be called from another thread, and the request holds until it is cleared by stop(false)
+	 */
+	virtual void stop(bool flag = true) {}
+	/**
+	 * search the position until stop() without playing a move, e.g., for analysis
+	 */
+	virtual void ponder(const board& b) {}
+	/**
+	 * let the search publish its statistics every given milliseconds (0 for never), and copy the latest statistics,
+	 * which may be called from another thread while searching, where report returns false if the agent cannot report
+	 */
+	virtual void watch(int interval) {}
+	virtual bool report(std::vector<root_report>& list) { return false; }
 
 public:
 	virtual std::string property(const std::string& key) const { return meta.at(key); }
@@ -101,1239 +158,529 @@ private:
 };
 
 
-class mtcs_with_sample_rave_player : public random_agent {
+/**
+ * player with the alpha-beta search, see alphabeta.h
+ * the search runs for "timeout=ms" (1000 by default, 0 for no deadline) up to "depth=N" plies, with a table of "hash=MB"
+ */
+class alphabeta_player : public random_agent {
 public:
-	mtcs_with_sample_rave_player(const std::string& args = "") : random_agent("name=random role=unknown " + args),
-		space(board::size_x * board::size_y),space_opponent(board::size_x * board::size_y), who(board::empty) {
+	alphabeta_player(const std::string& args = "") : random_agent("name=alphabeta role=unknown " + args), who(board::empty) {
 		if (name().find_first_of("[]():; ") != std::string::npos)
 			throw std::invalid_argument("invalid name: " + name());
-		if (role() == "black"){
-			who = board::black;
-			opponent = board::white;
-		}
-		if (role() == "white"){
-			who = board::white;
-			opponent = board::black;
-		}
+		if (role() == "black") who = board::black;
+		if (role() == "white") who = board::white;
 		if (who == board::empty)
 			throw std::invalid_argument("invalid role: " + role());
-		for (size_t i = 0; i < space.size(); i++){
-			space[i] = action::place(i, who);
-			space1.push_back(action::place(i,who));
-			space_opponent[i] = action::place(i, opponent);
-			space_opponent1.push_back(action::place(i,opponent));
-		}
+		if (meta.find("timeout") != meta.end()) alphabeta.limit_time(time_t(meta["timeout"]));
+		if (meta.find("depth") != meta.end()) alphabeta.limit_depth(int(meta["depth"]));
+		if (meta.find("hash") != meta.end()) alphabeta.limit_memory(size_t(meta["hash"]) << 20);
 	}
 
-	static int myrandom (int i) { return std::rand()%i;}
-
-	bool simulation(const board& now,board::piece_type a){
-		bool ch=true;
-		board next=now;
-		int stat;
-		if(a==who) stat=1;
-		else stat=0;
-		std::srand(time(0));
-		std::random_shuffle(space1.begin(),space1.end(),myrandom);
-		std::random_shuffle(space_opponent1.begin(),space_opponent1.end(),myrandom);
-		
-		std::vector<action::place> rem;
-
-		for(int i=1;i<=74;i++){
-			if(i%2){
-				if(stat){
-					for (const action::place& move : space1) {
-						board ne=next;
-						if (move.apply(ne) == board::legal){
-							rem.push_back(move);
-							node_state[move].second++;
-							next=ne;
-							goto L_nextround;
-						}
-					}
-					ch=false;
-					break;
-				}
-				else{
-					for (const action::place& move : space_opponent1) {
-						board ne=next;
-						if (move.apply(ne) == board::legal){
-							next=ne;
-							goto L_nextround;
-						}
-					}
-					ch=true;
-					break;
-				}
-			}
-			else{
-				if(stat){
-					for (const action::place& move : space_opponent1) {
-						board ne=next;
-						if (move.apply(ne) == board::legal){
-							next=ne;
-							goto L_nextround;
-						}
-					}
-					ch=true;
-					break;
-				}
-				else{
-					for (const action::place& move : space1) {
-						board ne=next;
-						if (move.apply(ne) == board::legal){
-							rem.push_back(move);
-							node_state[move].second++;
-							next=ne;
-							goto L_nextround;
-						}
-					}
-					ch=false;
-					break;
-				}
-			}
-			L_nextround:;
-		}
-		if(ch) for(auto it:rem) node_state[it].first++;
-		return ch;
+	virtual void open_episode(const std::string& flag = "") {
+		alphabeta.clear();
 	}
 
 	virtual action take_action(const board& state) {
-		std::shuffle(space.begin(), space.end(), engine);
-		std::shuffle(space_opponent.begin(),space_opponent.end(),engine);
-		node_state.clear();
-		for(auto it:space) node_state[it]=std::make_pair(0,0);
+		int move = alphabeta.search(state);
+		return move != -1 ? action::place(move, who) : action();
+	}
 
-		for (const action::place& move : space) {
-			board after = state;
-			if (move.apply(after) == board::legal){
-				for(int i=0;i<30;i++) {
-					node_state[move].second++;
-					if(simulation(after,opponent)) node_state[move].first++;
-				}
-			}
-		}
-		action::place best_move;
-		float best_win_rate=0;
-		for(auto it:node_state){
-			if(it.second.second!=0&&(float)it.second.first/it.second.second>best_win_rate){
-				best_move=it.first;
-				best_win_rate=(float)it.second.first/it.second.second;
-			}
-		}
-		return best_move;
+	virtual void stop(bool flag = true) { alphabeta.stop(flag); }
+
+	virtual search_info last_search() const {
+		search_info info = {};
+		info.iterations = alphabeta.depth();
+		info.nodes = alphabeta.node_count();
+		info.depth = alphabeta.depth();
+		if (alphabeta.score() >= alphabeta_search::win_score - alphabeta_search::max_ply) info.result = 1;
+		if (alphabeta.score() <= -alphabeta_search::win_score + alphabeta_search::max_ply) info.result = -1;
+		return info;
 	}
 
 private:
-	std::vector<action::place> space;
-	std::vector<action::place> space_opponent;
-	std::vector<action::place> space1;
-	std::vector<action::place> space_opponent1;
+	alphabeta_search alphabeta;
 	board::piece_type who;
-	board::piece_type opponent;
-	std::map<action::place,std::pair<int,int>> node_state;
 };
 
-
-class mtcs_uct_rave_player : public random_agent {
+/**
+ * base agent for players with Monte-Carlo tree search, assembled from the policies in mcts.h at compile time,
+ * i.e., the selection policy (uct_selection, rave_selection, or flat_selection), the playout policy (random_playout),
+ * and the backup policy (player_backup or negamax_backup), so that the iterations are specialized and fully inlined
+ * the search tree is kept in a preallocated node pool (see mcts.h), and its size can be set by "nodes=N"
+ *
+ * progressive widening is enabled by "pw_c=C" (and optionally "pw_alpha=A", 0.5 by default),
+ * a node visited n times then only considers its best ceil(C * n^A) moves, ranked by their all-moves-as-first priors
+ */
+template<class selection = uct_selection, class playout = random_playout, class backup = player_backup>
+class mcts_agent : public random_agent {
 public:
-	mtcs_uct_rave_player(const std::string& args = "") : random_agent("name=random role=unknown " + args),
-		space(board::size_x * board::size_y),space_opponent(board::size_x * board::size_y), who(board::empty) {
+	mcts_agent(const std::string& args = "") : random_agent("name=random role=unknown " + args),
+		space(board::size_x * board::size_y), space_opponent(board::size_x * board::size_y), who(board::empty),
+		tree(meta.find("nodes") != meta.end() ? size_t(meta["nodes"]) : size_t(1 << 18)), pw_c(0), pw_alpha(0.5), info(), interrupted(false), interval(0) {
 		if (name().find_first_of("[]():; ") != std::string::npos)
 			throw std::invalid_argument("invalid name: " + name());
-		if (role() == "black"){
+		if (role() == "black") {
 			who = board::black;
 			opponent = board::white;
 		}
-		if (role() == "white"){
+		if (role() == "white") {
 			who = board::white;
 			opponent = board::black;
 		}
 		if (who == board::empty)
 			throw std::invalid_argument("invalid role: " + role());
-		for (size_t i = 0; i < space.size(); i++){
+		for (size_t i = 0; i < space.size(); i++) {
 			space[i] = action::place(i, who);
-			space1.push_back(action::place(i,who));
+			space1.push_back(action::place(i, who));
 			space_opponent[i] = action::place(i, opponent);
-			space_opponent1.push_back(action::place(i,opponent));
-		}
+			space_opponent1.push_back(action::place(i, opponent));
+		}
+		if (meta.find("pw_c") != meta.end()) pw_c = float(meta["pw_c"]);
+		if (meta.find("pw_alpha") != meta.end()) pw_alpha = float(meta["pw_alpha"]);
+		node_state.fill({0, 0});
+	}
+
+	/**
+	 * simulate one game by the playout policy, starting from the given state and side to move
+	 * the moves of both sides are recorded into node_state as all-moves-as-first statistics
+	 * return true if this player wins
+	 */
+	bool simulation(board next, board::piece_type a) {
+		std::shuffle(space1.begin(), space1.end(), engine);
+		std::shuffle(space_opponent1.begin(), space_opponent1.end(), engine);
+
+		int rem[board::size_x * board::size_y];
+		size_t rem_cnt = 0;
+		board::piece_type loser = playout::run(next, a, who, space1, space_opponent1, [&](int i, board::piece_type side) {
+			std::pair<int, int>& s = stat(i, side);
+			rem[rem_cnt++] = &s - &node_state[0];
+			s.second++;
+		});
+		bool ch = (loser != who);
+		if (ch) for (size_t i = 0; i < rem_cnt; i++) node_state[rem[i]].first++;
+		return ch;
 	}
 
-	static int myrandom (int i) { return std::rand()%i;}
-
-	bool simulation(const board& now,board::piece_type a){
-		bool ch=true;
-		board next=now;
-		int stat;
-		if(a==who) stat=1;
-		else stat=0;
-		std::srand(time(0));
-		std::random_shuffle(space1.begin(),space1.end(),myrandom);
-		std::random_shuffle(space_opponent1.begin(),space_opponent1.end(),myrandom);
-		
-		std::vector<action::place> rem;
-
-		for(int i=1;i<=74;i++){
-			if(i%2){
-				if(stat){
-					for (const action::place& move : space1) {
-						board ne=next;
-						if (move.apply(ne) == board::legal){
-							rem.push_back(move);
-							node_state[move].second++;
-							next=ne;
-							goto L_nextround;
-						}
-					}
-					ch=false;
-					break;
-				}
-				else{
-					for (const action::place& move : space_opponent1) {
-						board ne=next;
-						if (move.apply(ne) == board::legal){
-							next=ne;
-							goto L_nextround;
-						}
-					}
-					ch=true;
-					break;
-				}
-			}
-			else{
-				if(stat){
-					for (const action::place& move : space_opponent1) {
-						board ne=next;
-						if (move.apply(ne) == board::legal){
-							next=ne;
-							goto L_nextround;
-						}
-					}
-					ch=true;
-					break;
-				}
-				else{
-					for (const action::place& move : space1) {
-						board ne=next;
-						if (move.apply(ne) == board::legal){
-							rem.push_back(move);
-							node_state[move].second++;
-							next=ne;
-							goto L_nextround;
-						}
-					}
-					ch=false;
-					break;
+	/**
+	 * discard the all-moves-as-first statistics of the previous searches
+	 */
+	void clear_statistics() {
+		node_state.fill({0, 0});
+	}
+
+	/**
+	 * discard the previous tree and start a new search from the given state
+	 */
+	void init_tree(const board& state, board::piece_type w) {
+		tree.reset(state, w);
+		info = {};
+		interrupted = false;
+	}
+
+	/**
+	 * whether the tree is of an interrupted search of the position, e.g., of a ponder, which can be resumed
+	 */
+	bool resumable(const board& state, board::piece_type w) {
+		return interrupted && tree.size() > 1 && tree.root().w == w && tree.state().hash() == state.hash();
+	}
+
+	/**
+	 * run one iteration of the search: selection, expansion, simulation, and propagation back
+	 * the iteration works on a single board and the preallocated tree, hence never allocates
+	 */
+	void update() {
+		board state = tree.state();
+		mcts_tree::node* now = &tree.root();
+		tree.clear_path();
+		tree.push_path(now);
+
+		// find leaf, expand it, and create the child to be simulated
+		for (int depth = 0; depth < selection::max_depth; depth++) {
+			if (!now->is_expanded() && !expand(*now, state)) break;
+			if (now->child_cnt < width(*now)) {
+				create(now, state);
+				break;
+			}
+			if (now->child_cnt == 0) break; // no legal move
+
+			float bonus = uct_table::sqrt_log(now->game_cnt);
+			float max_score = -1e9f;
+			mcts_tree::node* next = nullptr;
+			for (mcts_tree::node* child = tree.child(*now); child; child = tree.sibling(*child)) {
+				if (child->proof != mcts_tree::unknown) continue; // solved subtrees need no more search
+				float amaf_rate = 0;
+				int amaf_games = 0;
+				if (selection::uses_amaf) {
+					const std::pair<int, int>& s = stat(child->move, now->w);
+					amaf_games = s.second;
+					amaf_rate = s.second ? float(s.first) / s.second : 0;
+					if (!backup::for_player(now->w, who)) amaf_rate = 1 - amaf_rate;
+				}
+				float score = selection::score(*child, bonus, amaf_rate, amaf_games);
+				if (score > max_score) {
+					max_score = score;
+					next = child;
 				}
 			}
-			L_nextround:;
+			if (!next) { // all considered children are solved, but the node is not
+				create(now, state);
+				break;
+			}
+			now = next;
+			mcts_tree::play(state, *now);
+			tree.push_path(now);
+		}
+
+		// simulation, which is not needed if the leaf is already solved
+		bool solved = tree.prove(*now);
+		bool win = solved ? now->proof == mcts_tree::win : simulation(state, now->w);
+		info.iterations++;
+		info.playouts += !solved;
+		info.depth = std::max<uint16_t>(info.depth, tree.path_end() - tree.path_begin() - 1);
+
+		// propagation back, the proofs are also backed up until a node cannot be proven
+		bool proven = true;
+		for (mcts_tree::node** it = tree.path_end(); it != tree.path_begin(); ) {
+			mcts_tree::node& n = **(--it);
+			board::piece_type mover = static_cast<board::piece_type>(3u - n.w);
+			n.game_cnt++;
+			if (win == backup::for_player(mover, who)) n.win_cnt++;
+			if (proven) proven = tree.prove(n);
+			if (n.move == -1) continue; // root
+			std::pair<int, int>& s = stat(n.move, mover);
+			s.second++;
+			if (win) s.first++;
 		}
-		
-		if(ch) for(auto it:rem) node_state[it].first++;
-		
-		return ch;
 	}
 
-	struct tree_node{
-		tree_node* next[100]={nullptr};
-		int win_cnt=0;
-		int game_cnt=0;
-		board b;
-		board::piece_type w;
-		action::place pos;
-		tree_node(board b,board::piece_type w):b(b),w(w){}
-		tree_node(board b,board::piece_type w,action::place pos):b(b),w(w),pos(pos){}
-		bool is_leaf(){
-			bool t=true;
-			for(int i=0;i<100;i++){
-				if(next[i]) t=false; 
+	/**
+	 * run the given iterations of the search, or stop early once the root is proven or the search is stopped
+	 * by the token (see stop), where a stopped search is resumed by searching again, since the tree is kept
+	 */
+	void search(int iterations) {
+		auto next = std::chrono::steady_clock::now();
+		interrupted = false;
+		for (int i = 0; i < iterations && tree.root().proof == mcts_tree::unknown; i++) {
+			if (token.poll(i)) {
+				interrupted = true;
+				break;
 			}
-			return t;
-		}
-	};
+			update();
+			// the statistics are published by the search itself, which costs a clock read every 256 iterations
+			if ((i & 0xff) == 0xff && interval.load(std::memory_order_relaxed) && std::chrono::steady_clock::now() >= next) {
+				publish();
+				next = std::chrono::steady_clock::now() + std::chrono::milliseconds(interval.load(std::memory_order_relaxed));
+			}
+		}
+		if (interval.load(std::memory_order_relaxed)) publish();
+		info.nodes = tree.size();
+		info.result = tree.root().proof;
+	}
 
-	void init(const board& state,board::piece_type w){
-		std::queue<tree_node *> q;
-		if(root) q.push(root);
-		while(q.size()!=0){
-			tree_node* now=q.front();
-			q.pop();
-			for(int i=0;i<100;i++) if(now->next[i]) q.push(now->next[i]);
-			free(now);
+	virtual void ponder(const board& state) {
+		board::piece_type w = static_cast<board::piece_type>(state.info().who_take_turns);
+		if (!resumable(state, w)) {
+			clear_statistics();
+			init_tree(state, w);
 		}
-		root=new tree_node(state,w);
+		token.expire_after(0);
+		search(INT_MAX);
+	}
+
+	virtual void watch(int ms) { interval.store(std::max(ms, 0), std::memory_order_relaxed); }
+
+	virtual bool report(std::vector<root_report>& list) {
+		std::lock_guard<std::mutex> lock(published_lock);
+		list = published;
+		return true;
 	}
 
-	void update(){
-		std::queue<tree_node *> q;
-		tree_node *now=root;
-		bool not_end=true;
-		if(now){
-			// find leaf
-			q.push(now);
-			while(!now->is_leaf()){
-				float score=0;
-				float max_score=0;
-				int max_ind=0;
-				not_end=false;
-				for(int i=0;i<100;i++){
-					if(now->next[i]){
-						board t=now->b;
-						if(now->next[i]->pos.apply(t)==board::legal){
-							not_end=true;
-							//std::cout << now->next[i]->pos << '\n';
-							if(now->next[i]->game_cnt==0) score=100000;
-							else score= (float)now->next[i]->win_cnt/now->next[i]->game_cnt + sqrt(log(now->game_cnt)/now->next[i]->game_cnt);
-							//std::cout << i << " " << score << '\n';
-							if(score>max_score){
-								//std::cout << i << " " << score << " " << max_score << '\n';
-								max_score=score;
-								max_ind=i;
-							}
-						}
-					}
-				}
-				if(not_end){
-					now=now->next[max_ind];
-					q.push(now);
-				}
-				else break;
-			}
+	virtual search_info last_search() const { return info; }
 
-			// expension
-			if(not_end){
-				if(now->w==who){
-					int i=0;
-					for(auto it:space){
-						board b_now=now->b;
-						it.apply(b_now);
-						now->next[i]=new tree_node(b_now,opponent,it);
-						i++;
-					}
-				}
-				else{
-					int i=0;
-					for(auto it:space_opponent){
-						board b_now=now->b;
-						it.apply(b_now);
-						now->next[i]=new tree_node(b_now,who,it);
-						i++;
-					}
-				}
-			}
-
-			// simulation
-			bool win=false;
-			if(not_end){
-				for(int i=0;i<100;i++){
-					board t=now->b;
-					if(now->next[i]){
-						if(now->next[i]->pos.apply(t)==board::legal){
-							now=now->next[i];
-							q.push(now);
-							win=simulation(now->b,now->w);
-							break;
-						}
-					}
-				}
-			}
-			else{
-				q.push(now);
-				win=simulation(now->b,now->w);
-			}
-			// propagation back
-			while(q.size()!=0){
-				tree_node* now=q.front();
-				q.pop();
-				node_state[now->pos].second++;
-				now->game_cnt++;
-				if(win){
-					node_state[now->pos].first++;
-					now->win_cnt++;
-				}
-			}
+	virtual void stop(bool flag = true) { token.cancel(flag); }
 
+	/**
+	 * the proof of a move at the root, see mcts_tree::proof_type
+	 */
+	int proof(int move) {
+		mcts_tree::node& root = tree.root();
+		for (mcts_tree::node* child = tree.child(root); child; child = tree.sibling(*child)) {
+			if (child->move == move) return child->proof;
 		}
+		return mcts_tree::unknown;
 	}
 
-	void dump_root(){
-		std::queue<tree_node *> q;
-		if(root) q.push(root);
-		
-		for(int i=0;i<100;i++){ 
-			if(root->next[i]&&root->next[i]->game_cnt!=0){
-				std::cout << root->next[i]->pos << " " << root->next[i]->win_cnt << " " << root->next[i]->game_cnt << '\n';
-			}
-		}
-		std::cout << '\n' << '\n';
-		
-		/*
-		while(q.size()!=0){
-			tree_node* now=q.front();
-			q.pop();
-			for(int i=0;i<100;i++){
-				if(now->next[i]&&now->next[i]->game_cnt!=0){
-					if(now->next[i]) q.push(now->next[i]);
-				}
-			}
-			std::cout << now->pos << " " <<  now->win_cnt << " " << now->game_cnt << '\n';
+	/**
+	 * the move proven to win at the root, or -1 if none
+	 */
+	int proven_move() {
+		mcts_tree::node& root = tree.root();
+		for (mcts_tree::node* child = tree.child(root); child; child = tree.sibling(*child)) {
+			if (child->proof == mcts_tree::win) return child->move;
 		}
-		std::cout << '\n' << '\n';
-		*/
+		return -1;
 	}
 
-	virtual void open_episode(const std::string& flag = "") {
-		time_control=10;
+	/**
+	 * the win count (for this player) and game count of a move at the root, or (0, 0) if it is not visited
+	 */
+	std::pair<int, int> root_stat(int move) {
+		mcts_tree::node& root = tree.root();
+		for (mcts_tree::node* child = tree.child(root); child; child = tree.sibling(*child)) {
+			if (child->move == move) return {child->win_cnt, child->game_cnt};
+		}
+		return {0, 0};
 	}
 
-	virtual action take_action(const board& state) {
-		//std::cout << state << '\n';
-		std::shuffle(space.begin(), space.end(), engine);
-		std::shuffle(space_opponent.begin(),space_opponent.end(),engine);
-
-		node_state.clear();
-		for(auto it:space) node_state[it]=std::make_pair(0,0);
-
-		action::place best_move;		
-		
-		init(state,who);
-		for(int i=0;i<time_control;i++) update();
-		if(time_control<600) time_control+=30;
-		else time_control-=20;
-		//dump_root();
-		
-		float best_win_rate=0;
-		for(int i=0;i<100;i++){ 
-			board t=root->b;
-			if(root->next[i]&&root->next[i]->pos.apply(t)==board::legal){
-				//std::cout << root->next[i]->pos << " " <<  node_state[root->next[i]->pos].first << " " << node_state[root->next[i]->pos].second << '\n';
-				
-				if(node_state[root->next[i]->pos].second!=0){
-					if((float)node_state[root->next[i]->pos].first/node_state[root->next[i]->pos].second>best_win_rate){
-						best_win_rate=(float)node_state[root->next[i]->pos].first/node_state[root->next[i]->pos].second;
-						best_move=root->next[i]->pos;
-					}
-				}
-				
-				/*
-				if((float)root->next[i]->win_cnt/root->next[i]->game_cnt>best_win_rate){
-					best_win_rate=(float)root->next[i]->win_cnt/root->next[i]->game_cnt;
-					best_move=root->next[i]->pos;
-				}
-				*/	
-			}
-		}
-		
-		//std::cout << best_move << " " << best_win_rate << '\n';
-		//std::cout << '\n';
+	/**
+	 * whether a move at the root is proven to lose while some other moves are not
+	 */
+	bool losing(int move) {
+		return tree.root().proof != mcts_tree::loss && proof(move) == mcts_tree::loss;
+	}
 
-		return best_move;
+protected:
+	/**
+	 * publish the statistics of the root children, sorted by their visits, with their principal variations
+	 * by the most visited children
+	 */
+	void publish() {
+		std::vector<root_report> list;
+		mcts_tree::node& root = tree.root();
+		for (mcts_tree::node* child = tree.child(root); child; child = tree.sibling(*child)) {
+			if (child->game_cnt == 0 && child->proof == mcts_tree::unknown) continue;
+			const std::pair<int, int>& s = stat(child->move, root.w);
+			float amaf = s.second ? float(s.first) / s.second : 0;
+			if (!backup::for_player(root.w, who)) amaf = 1 - amaf;
+			root_report r = { child->move, child->game_cnt, child->game_cnt ? float(child->win_cnt) / child->game_cnt : 0,
+			                  amaf, child->proof, { child->move } };
+			for (mcts_tree::node* n = child; n->is_expanded() && r.pv.size() < 16; ) {
+				mcts_tree::node* best = nullptr;
+				for (mcts_tree::node* c = tree.child(*n); c; c = tree.sibling(*c)) {
+					if (c->game_cnt && (!best || c->game_cnt > best->game_cnt)) best = c;
+				}
+				if (!best) break;
+				r.pv.push_back(best->move);
+				n = best;
+			}
+			list.push_back(std::move(r));
+		}
+		std::sort(list.begin(), list.end(), [](const root_report& a, const root_report& b) { return a.visits > b.visits; });
+		std::lock_guard<std::mutex> lock(published_lock);
+		published.swap(list);
+	}
+
+	/**
+	 * the win count (for this player) and game count of a move played by a side, over all simulations of the search
+	 */
+	std::pair<int, int>& stat(int i, board::piece_type w) {
+		return node_state[(w == who ? 0 : 1) * board::size_x * board::size_y + i];
+	}
+
+	/**
+	 * list the legal moves of a node, ranked by their priors if progressive widening is enabled
+	 */
+	bool expand(mcts_tree::node& n, const board& state) {
+		if (pw_c <= 0) return tree.expand(n, state, n.w == who ? space : space_opponent);
+		for (int i = 0; i < board::size_x * board::size_y; i++) {
+			const std::pair<int, int>& s = stat(i, n.w);
+			float rate = (s.first + 1.0f) / (s.second + 2.0f);
+			prior[i] = n.w == who ? rate : 1 - rate;
+		}
+		return tree.expand(n, state, n.w == who ? space : space_opponent, prior);
+	}
+
+	/**
+	 * create the next child of a node and move the leaf to it, if the pool still has space
+	 */
+	void create(mcts_tree::node*& now, board& state) {
+		mcts_tree::node* next = tree.create(*now);
+		if (!next) return;
+		now = next;
+		mcts_tree::play(state, *now);
+		tree.push_path(now);
+	}
+
+	/**
+	 * the number of moves of a node to be considered, which grows with its visits under progressive widening
+	 */
+	int width(const mcts_tree::node& n) const {
+		if (pw_c <= 0 || n.child_cnt >= n.legal_cnt) return n.legal_cnt;
+		int w = std::ceil(pw_c * std::pow(float(n.game_cnt), pw_alpha));
+		return std::max(1, std::min<int>(w, n.legal_cnt));
 	}
 
-private:
+protected:
 	std::vector<action::place> space;
 	std::vector<action::place> space_opponent;
 	std::vector<action::place> space1;
 	std::vector<action::place> space_opponent1;
 	board::piece_type who;
 	board::piece_type opponent;
-	std::map<action::place,std::pair<int,int>> node_state;
-	tree_node *root=nullptr;
-
-	int time_control=10;
+	std::array<std::pair<int, int>, 2 * board::size_x * board::size_y> node_state;
+	mcts_tree tree;
+	float pw_c;
+	float pw_alpha;
+	float prior[board::size_x * board::size_y];
+	search_info info;
+	cancel_token token;
+	bool interrupted; // whether the last search is stopped by the token
+	std::atomic<int> interval;
+	std::mutex published_lock;
+	std::vector<root_report> published;
 };
 
-
-class mtcs_uct_rave_pn_player : public random_agent {
+/**
+ * player with the Monte-Carlo tree search, assembled from the search policies and the endgame solver at compile time
+ *
+ * a move searches "iterations=N" iterations, then the budget grows by "grow=G" per move while it is below "peak=P",
+ * and shrinks by "decay=D" per move otherwise
+ * the move is decided by the win rates of the root children ("decision=tree"), or by the all-moves-as-first
+ * win rates of the moves ("decision=amaf"), skipping the moves proven to lose and preferring the moves proven to win
+ *
+ * with an endgame solver (endgame_solver, or no_solver for none), the solver takes over after "pn_step=N" moves (40),
+ * or once this player has fewer than "pn_moves=N" moves (12) and the opponent has fewer than "pn_replies=N" replies (15)
+ * an opening book given by "book=path" is probed before any search, see book.h
+ * a move is searched for at most "timeout=ms" if given, and a stopped search (see stop) returns its best move so far,
+ * where the tree of a search stopped before it finished, e.g., a ponder, is resumed if the same position is searched
+ */
+template<class selection, class playout, class backup, class solver_type>
+class mcts_player : public mcts_agent<selection, playout, backup> {
 public:
-	mtcs_uct_rave_pn_player(const std::string& args = "") : random_agent("name=random role=unknown " + args),
-		space(board::size_x * board::size_y),space_opponent(board::size_x * board::size_y), who(board::empty) {
-		if (name().find_first_of("[]():; ") != std::string::npos)
-			throw std::invalid_argument("invalid name: " + name());
-		if (role() == "black"){
-			who = board::black;
-			opponent = board::white;
-		}
-		if (role() == "white"){
-			who = board::white;
-			opponent = board::black;
-		}
-		if (who == board::empty)
-			throw std::invalid_argument("invalid role: " + role());
-		for (size_t i = 0; i < space.size(); i++){
-			space[i] = action::place(i, who);
-			space1.push_back(action::place(i,who));
-			space_opponent[i] = action::place(i, opponent);
-			space_opponent1.push_back(action::place(i,opponent));
-		}
-	}
-
-	static int myrandom (int i) { return std::rand()%i;}
-
-	// simulate one game
-	bool simulation(const board& now,board::piece_type a){
-		bool ch=true;
-		board next=now;
-		int stat;
-		if(a==who) stat=1;
-		else stat=0;
-		std::srand(time(0));
-		std::random_shuffle(space1.begin(),space1.end(),myrandom);
-		std::random_shuffle(space_opponent1.begin(),space_opponent1.end(),myrandom);
-		
-		std::vector<action::place> rem;
-
-		for(int i=1;i<=74;i++){
-			if(i%2){
-				if(stat){
-					for (const action::place& move : space1) {
-						board ne=next;
-						if (move.apply(ne) == board::legal){
-							rem.push_back(move);
-							node_state[move].second++;
-							next=ne;
-							goto L_nextround;
-						}
-					}
-					ch=false;
-					break;
-				}
-				else{
-					for (const action::place& move : space_opponent1) {
-						board ne=next;
-						if (move.apply(ne) == board::legal){
-							next=ne;
-							goto L_nextround;
-						}
-					}
-					ch=true;
-					break;
-				}
-			}
-			else{
-				if(stat){
-					for (const action::place& move : space_opponent1) {
-						board ne=next;
-						if (move.apply(ne) == board::legal){
-							next=ne;
-							goto L_nextround;
-						}
-					}
-					ch=true;
-					break;
-				}
-				else{
-					for (const action::place& move : space1) {
-						board ne=next;
-						if (move.apply(ne) == board::legal){
-							rem.push_back(move);
-							node_state[move].second++;
-							next=ne;
-							goto L_nextround;
-						}
-					}
-					ch=false;
-					break;
-				}
-			}
-			L_nextround:;
-		}
-		
-		if(ch) for(auto it:rem) node_state[it].first++;
-		
-		return ch;
-	}
-
-	struct tree_node{
-		tree_node* next[100]={nullptr};
-		int win_cnt=0;
-		int game_cnt=0;
-		board b;
-		board::piece_type w;
-		action::place pos;
-		int pn_num=1000;
-		int dn_num=1000;
-		tree_node(){}
-		tree_node(board b,board::piece_type w):b(b),w(w){}
-		tree_node(board b,board::piece_type w,action::place pos):b(b),w(w),pos(pos){}
-		bool is_leaf(){
-			bool t=true;
-			for(int i=0;i<100;i++){
-				if(next[i]) t=false; 
-			}
-			return t;
-		}
-	};
-
-	// initial mtcs tree
-	void init(const board& state,board::piece_type w){
-		std::queue<tree_node *> q;
-		if(root) q.push(root);
-		while(q.size()!=0){
-			tree_node* now=q.front();
-			q.pop();
-			for(int i=0;i<100;i++) if(now->next[i]) q.push(now->next[i]);
-			free(now);
-		}
-		root=new tree_node(state,w);
-	}
-
-	// mtcg update
-	void update(){
-		std::queue<tree_node *> q;
-		tree_node *now=root;
-		bool not_end=true;
-		if(now){
-			// find leaf
-			q.push(now);
-			while(!now->is_leaf()){
-				float score=0;
-				float max_score=0;
-				int max_ind=0;
-				not_end=false;
-				for(int i=0;i<100;i++){
-					if(now->next[i]){
-						board t=now->b;
-						if(now->next[i]->pos.apply(t)==board::legal){
-							not_end=true;
-							//std::cout << now->next[i]->pos << '\n';
-							if(now->next[i]->game_cnt==0) score=100000;
-							else score= (float)now->next[i]->win_cnt/now->next[i]->game_cnt + sqrt(log(now->game_cnt)/now->next[i]->game_cnt);
-							//std::cout << i << " " << score << '\n';
-							if(score>max_score){
-								//std::cout << i << " " << score << " " << max_score << '\n';
-								max_score=score;
-								max_ind=i;
-							}
-						}
-					}
-				}
-				if(not_end){
-					now=now->next[max_ind];
-					q.push(now);
-				}
-				else break;
-			}
-
-			// expension
-			if(not_end){
-				if(now->w==who){
-					int i=0;
-					for(auto it:space){
-						board b_now=now->b;
-						it.apply(b_now);
-						now->next[i]=new tree_node(b_now,opponent,it);
-						i++;
-					}
-				}
-				else{
-					int i=0;
-					for(auto it:space_opponent){
-						board b_now=now->b;
-						it.apply(b_now);
-						now->next[i]=new tree_node(b_now,who,it);
-						i++;
-					}
-				}
-			}
-
-			// simulation
-			bool win=false;
-			if(not_end){
-				for(int i=0;i<100;i++){
-					board t=now->b;
-					if(now->next[i]){
-						if(now->next[i]->pos.apply(t)==board::legal){
-							now=now->next[i];
-							q.push(now);
-							win=simulation(now->b,now->w);
-							break;
-						}
-					}
-				}
-			}
-			else{
-				q.push(now);
-				win=simulation(now->b,now->w);
-			}
-			// propagation back
-			while(q.size()!=0){
-				tree_node* now=q.front();
-				q.pop();
-				node_state[now->pos].second++;
-				now->game_cnt++;
-				if(win){
-					node_state[now->pos].first++;
-					now->win_cnt++;
-				}
-			}
-
-		}
-	}
-
-	tree_node pn_dfs(tree_node* now){
-		tree_node ret;
-		int p,d;
-		if(now->w==who){
-			int i=0;
-			p=0x3f3f3f3f;
-			d=0;
-			for(auto it:space){
-				board b_now=now->b;
-				if(it.apply(b_now)==board::legal){
-					now->next[i]=new tree_node(b_now,opponent,it);
-					tree_node r=pn_dfs(now->next[i]);
-					i++;
-					p=std::min(p,r.pn_num);
-					d=std::max(d,d+r.dn_num);
-					if(p==0||d==0x3f3f3f3f) break;
-				}
-			}		
-		}
-		else{
-			int i=0;
-			p=0;
-			d=0x3f3f3f3f;
-			for(auto it:space_opponent){
-				board b_now=now->b;
-				if(it.apply(b_now)==board::legal){
-					now->next[i]=new tree_node(b_now,who,it);
-					tree_node r=pn_dfs(now->next[i]);
-					i++;
-					p=std::max(p,p+r.pn_num);
-					d=std::min(d,r.dn_num);
-					if(p==0x3f3f3f3f||d==0) break;
-				}
-			}
-		}
-		now->pn_num=p;
-		now->dn_num=d;
-		ret.pn_num=p;
-		ret.dn_num=d;
-		return ret;
-	}
-
-	void pn_search(){
-		pn_dfs(root);
+	typedef mcts_agent<selection, playout, backup> base;
+
+	mcts_player(const std::string& args = "") : base(args),
+		initial(1000), grow(0), peak(0), decay(0), by_amaf(false), pn_step(40), pn_moves(12), pn_replies(15), timeout(0) {
+		if (this->meta.find("iterations") != this->meta.end()) initial = int(this->meta["iterations"]);
+		if (this->meta.find("grow") != this->meta.end()) grow = int(this->meta["grow"]);
+		if (this->meta.find("peak") != this->meta.end()) peak = int(this->meta["peak"]);
+		if (this->meta.find("decay") != this->meta.end()) decay = int(this->meta["decay"]);
+		if (this->meta.find("decision") != this->meta.end()) by_amaf = (std::string(this->meta["decision"]) == "amaf");
+		if (this->meta.find("pn_step") != this->meta.end()) pn_step = int(this->meta["pn_step"]);
+		if (this->meta.find("pn_moves") != this->meta.end()) pn_moves = int(this->meta["pn_moves"]);
+		if (this->meta.find("pn_replies") != this->meta.end()) pn_replies = int(this->meta["pn_replies"]);
+		if (this->meta.find("timeout") != this->meta.end()) timeout = time_t(this->meta["timeout"]);
+		if (this->meta.find("book") != this->meta.end()) book.open(std::string(this->meta["book"]));
+		solver.configure(this->meta);
+		open_episode();
 	}
 
-	// for debug
-	void dump_root(){
-		std::queue<tree_node *> q;
-		if(root) q.push(root);
-		
-		for(int i=0;i<100;i++){ 
-			if(root->next[i]&&root->next[i]->game_cnt!=0){
-				std::cout << root->next[i]->pos << " " << root->next[i]->win_cnt << " " << root->next[i]->game_cnt << '\n';
-			}
-		}
-		std::cout << '\n' << '\n';
-		
-		/*
-		while(q.size()!=0){
-			tree_node* now=q.front();
-			q.pop();
-			for(int i=0;i<100;i++){
-				if(now->next[i]&&now->next[i]->game_cnt!=0){
-					if(now->next[i]) q.push(now->next[i]);
-				}
-			}
-			std::cout << now->pos << " " <<  now->win_cnt << " " << now->game_cnt << '\n';
-		}
-		std::cout << '\n' << '\n';
-		*/
+	virtual void open_episode(const std::string& flag = "") {
+		step_cnt = 0;
+		budget = initial;
+		legal_cnt = reply_cnt = 0x3f3f3f3f;
+		solver.clear();
 	}
 
-	virtual void open_episode(const std::string& flag = "") {
-		step_cnt=0;
-		use_pns_threshold=0x3f3f3f3f;
-		use_pns_threshold_opponent=0x3f3f3f3f;
-		time_control=500;
-		down=false;
+	virtual void stop(bool flag = true) {
+		base::stop(flag);
+		solver.stop(flag);
 	}
 
 	virtual action take_action(const board& state) {
-		//std::cout << state << '\n';
-		std::shuffle(space.begin(), space.end(), engine);
-		std::shuffle(space_opponent.begin(),space_opponent.end(),engine);
-
-		node_state.clear();
-		for(auto it:space) node_state[it]=std::make_pair(0,0);
-
-		action::place best_move;		
-		
-		init(state,who);
+		board::piece_type who = this->who;
+		std::shuffle(this->space.begin(), this->space.end(), this->engine);
+		std::shuffle(this->space_opponent.begin(), this->space_opponent.end(), this->engine);
+		this->info = {};
 		step_cnt++;
-		//std::cout << use_pns_threshold << '\n';
-		//std::cout << use_pns_threshold_opponent << '\n';
-		if(step_cnt<=40&&!(use_pns_threshold<12&&use_pns_threshold_opponent<15)){
-			use_pns_threshold=0;
-			for(int i=0;i<time_control;i++) update();
-			if(down==false&&time_control<5000) time_control+=500;
-			else{
-				down=true;
-				time_control-=200;
-			}
-			//dump_root();
-			float best_win_rate=0;
-			bool cal_opponent=true;
-			for(int i=0;i<100;i++){ 
-				board t=root->b;
-				if(root->next[i]&&root->next[i]->pos.apply(t)==board::legal){
-					use_pns_threshold++;
-					if(cal_opponent){
-						use_pns_threshold_opponent=0;
-						for(auto it:space_opponent){
-							board test=t;
-							if(it.apply(test)==board::legal) use_pns_threshold_opponent++;
-						}
-						cal_opponent=false;
-					}
-					//std::cout << root->next[i]->pos << " " <<  node_state[root->next[i]->pos].first << " " << node_state[root->next[i]->pos].second << '\n';
-					if(node_state[root->next[i]->pos].second!=0){
-						if((float)node_state[root->next[i]->pos].first/node_state[root->next[i]->pos].second>best_win_rate){
-							best_win_rate=(float)node_state[root->next[i]->pos].first/node_state[root->next[i]->pos].second;
-							best_move=root->next[i]->pos;
-						}
-					}
-					/*
-					if((float)root->next[i]->win_cnt/root->next[i]->game_cnt>best_win_rate){
-						best_win_rate=(float)root->next[i]->win_cnt/root->next[i]->game_cnt;
-						best_move=root->next[i]->pos;
-					}
-					*/	
-				}
-			}
-			/*
-			if(step_cnt>27){
-				std::cout << 123 << '\n';
-				init(state,who);
-				pn_search();
-				std::cout << root->pn_num << '\n';
-			}
-			*/
-		}
-		else{
-			pn_search();
-			//std::cout << "pn_num: " << root->pn_num << '\n';
-			for(int i=0;i<100;i++){
-				board t=root->b;
-				if(root->next[i]&&root->next[i]->pos.apply(t)==board::legal){
-					if(root->next[i]->pn_num==0){
-						std::cout << "has_ans" << '\n';
-						best_move=root->next[i]->pos;
-						break;
-					}
-					else{best_move=root->next[i]->pos;}
-				}
-			}
-		}
-		return best_move;
-	}
 
-private:
-	std::vector<action::place> space;
-	std::vector<action::place> space_opponent;
-	std::vector<action::place> space1;
-	std::vector<action::place> space_opponent1;
-	board::piece_type who;
-	board::piece_type opponent;
-	std::map<action::place,std::pair<int,int>> node_state;
-	tree_node *root=nullptr;
+		// a lost position is not searched
+		if (!state.has_legal_move(who)) return action();
 
-	int use_pns_threshold=0x3f3f3f3f;
-	int use_pns_threshold_opponent=0x3f3f3f3f;
-	int time_control=500;
-	int step_cnt=0;
-	bool down=false;
-};
+		// a position solved before, in this game or another, is played at once
+		int known = solver.lookup(state);
+		if (known != -1) return this->info.result = 1, action::place(known, who);
 
+		// the opening book, see book.h
+		int opening = book.probe(state);
+		if (opening != -1) return action::place(opening, who);
 
-class mtcs_uct_player : public random_agent {
-public:
-	mtcs_uct_player(const std::string& args = "") : random_agent("name=random role=unknown " + args),
-		space(board::size_x * board::size_y),space_opponent(board::size_x * board::size_y), who(board::empty) {
-		if (name().find_first_of("[]():; ") != std::string::npos)
-			throw std::invalid_argument("invalid name: " + name());
-		if (role() == "black"){
-			who = board::black;
-			opponent = board::white;
-		}
-		if (role() == "white"){
-			who = board::white;
-			opponent = board::black;
-		}
-		if (who == board::empty)
-			throw std::invalid_argument("invalid role: " + role());
-		for (size_t i = 0; i < space.size(); i++){
-			space[i] = action::place(i, who);
-			space1.push_back(action::place(i,who));
-			space_opponent[i] = action::place(i, opponent);
-			space_opponent1.push_back(action::place(i,opponent));
+		if (solver_type::enabled && (step_cnt > pn_step || (legal_cnt < pn_moves && reply_cnt < pn_replies))) {
+			this->info.result = solver.solve(state);
+			this->info.nodes = solver.node_count();
+			if (solver.proven_move() != -1) return action::place(solver.proven_move(), who);
+			if (solver.promising_move() != -1) return action::place(solver.promising_move(), who);
+			return action();
 		}
-	}
 
-	static int myrandom (int i) { return std::rand()%i;}
-
-	// simulate one game
-	bool simulation(const board& now,board::piece_type a){
-		bool ch=true;
-		board next=now;
-		int stat;
-		if(a==who) stat=1;
-		else stat=0;
-		std::srand(time(0));
-		std::random_shuffle(space1.begin(),space1.end(),myrandom);
-		std::random_shuffle(space_opponent1.begin(),space_opponent1.end(),myrandom);
-		
-		std::vector<action::place> rem;
-
-		for(int i=1;i<=74;i++){
-			if(i%2){
-				if(stat){
-					for (const action::place& move : space1) {
-						board ne=next;
-						if (move.apply(ne) == board::legal){
-							rem.push_back(move);
-							node_state[move].second++;
-							next=ne;
-							goto L_nextround;
-						}
-					}
-					ch=false;
-					break;
-				}
-				else{
-					for (const action::place& move : space_opponent1) {
-						board ne=next;
-						if (move.apply(ne) == board::legal){
-							next=ne;
-							goto L_nextround;
-						}
-					}
-					ch=true;
-					break;
-				}
-			}
-			else{
-				if(stat){
-					for (const action::place& move : space_opponent1) {
-						board ne=next;
-						if (move.apply(ne) == board::legal){
-							next=ne;
-							goto L_nextround;
-						}
-					}
-					ch=true;
-					break;
-				}
-				else{
-					for (const action::place& move : space1) {
-						board ne=next;
-						if (move.apply(ne) == board::legal){
-							rem.push_back(move);
-							node_state[move].second++;
-							next=ne;
-							goto L_nextround;
-						}
-					}
-					ch=false;
-					break;
-				}
-			}
-			L_nextround:;
+		if (!this->resumable(state, who)) {
+			this->clear_statistics();
+			this->init_tree(state, who);
 		}
-		
-		if(ch) for(auto it:rem) node_state[it].first++;
-		
-		return ch;
-	}
+		this->token.expire_after(timeout);
+		this->search(budget);
+		budget = budget < peak ? budget + grow : budget - decay;
 
-	struct tree_node{
-		tree_node* next[100]={nullptr};
-		int win_cnt=0;
-		int game_cnt=0;
-		board b;
-		board::piece_type w;
-		action::place pos;
-		int pn_num=1000;
-		int dn_num=1000;
-		tree_node(){}
-		tree_node(board b,board::piece_type w):b(b),w(w){}
-		tree_node(board b,board::piece_type w,action::place pos):b(b),w(w),pos(pos){}
-		bool is_leaf(){
-			bool t=true;
-			for(int i=0;i<100;i++){
-				if(next[i]) t=false; 
+		// the mobility of both sides, for switching to the endgame solver
+		mcts_tree::node& root = this->tree.root();
+		legal_cnt = std::max<int>(root.legal_cnt, 0);
+		if (root.legal_cnt > 0) {
+			board after = state;
+			action::place(this->tree.moves(root)[0], who).apply(after);
+			reply_cnt = 0;
+			for (const action::place& move : this->space_opponent) {
+				board test = after;
+				if (move.apply(test) == board::legal) reply_cnt++;
 			}
-			return t;
 		}
-	};
-
-	// initial mtcs tree
-	void init(const board& state,board::piece_type w){
-		std::queue<tree_node *> q;
-		if(root) q.push(root);
-		while(q.size()!=0){
-			tree_node* now=q.front();
-			q.pop();
-			for(int i=0;i<100;i++) if(now->next[i]) q.push(now->next[i]);
-			free(now);
-		}
-		root=new tree_node(state,w);
-	}
 
-	// mtcg update
-	void update(){
-		std::queue<tree_node *> q;
-		tree_node *now=root;
-		bool not_end=true;
-		if(now){
-			// find leaf
-			q.push(now);
-			while(!now->is_leaf()){
-				float score=0;
-				float max_score=0;
-				int max_ind=0;
-				not_end=false;
-				for(int i=0;i<100;i++){
-					if(now->next[i]){
-						board t=now->b;
-						if(now->next[i]->pos.apply(t)==board::legal){
-							not_end=true;
-							//std::cout << now->next[i]->pos << '\n';
-							if(now->next[i]->game_cnt==0) score=100000;
-							else score= (float)now->next[i]->win_cnt/now->next[i]->game_cnt + sqrt(log(now->game_cnt)/now->next[i]->game_cnt);
-							//std::cout << i << " " << score << '\n';
-							if(score>max_score){
-								//std::cout << i << " " << score << " " << max_score << '\n';
-								max_score=score;
-								max_ind=i;
-							}
-						}
-					}
-				}
-				if(not_end){
-					now=now->next[max_ind];
-					q.push(now);
-				}
-				else break;
-			}
-
-			// expension
-			if(not_end){
-				if(now->w==who){
-					int i=0;
-					for(auto it:space){
-						board b_now=now->b;
-						it.apply(b_now);
-						now->next[i]=new tree_node(b_now,opponent,it);
-						i++;
-					}
-				}
-				else{
-					int i=0;
-					for(auto it:space_opponent){
-						board b_now=now->b;
-						it.apply(b_now);
-						now->next[i]=new tree_node(b_now,who,it);
-						i++;
-					}
-				}
-			}
-
-			// simulation
-			bool win=false;
-			if(not_end){
-				for(int i=0;i<100;i++){
-					board t=now->b;
-					if(now->next[i]){
-						if(now->next[i]->pos.apply(t)==board::legal){
-							now=now->next[i];
-							q.push(now);
-							win=simulation(now->b,now->w);
-							break;
-						}
-					}
-				}
-			}
-			else{
-				q.push(now);
-				win=simulation(now->b,now->w);
-			}
-			// propagation back
-			while(q.size()!=0){
-				tree_node* now=q.front();
-				q.pop();
-				node_state[now->pos].second++;
-				now->game_cnt++;
-				if(win){
-					node_state[now->pos].first++;
-					now->win_cnt++;
-				}
+		if (this->proven_move() != -1) return action::place(this->proven_move(), who);
+		action::place best_move;
+		float best_win_rate = 0;
+		for (int k = 0; k < root.legal_cnt; k++) {
+			int i = this->tree.moves(root)[k];
+			if (this->losing(i)) continue;
+			std::pair<int, int> s = by_amaf ? this->stat(i, who) : this->root_stat(i);
+			if (s.second != 0 && float(s.first) / s.second > best_win_rate) {
+				best_win_rate = float(s.first) / s.second;
+				best_move = action::place(i, who);
 			}
-
 		}
+		return best_move;
 	}
 
-	tree_node pn_dfs(tree_node* now){
-		tree_node ret;
-		int p,d;
-		if(now->w==who){
-			int i=0;
-			p=0x3f3f3f3f;
-			d=0;
-			for(auto it:space){
-				board b_now=now->b;
-				if(it.apply(b_now)==board::legal){
-					now->next[i]=new tree_node(b_now,opponent,it);
-					tree_node r=pn_dfs(now->next[i]);
-					i++;
-					p=std::min(p,r.pn_num);
-					d=std::max(d,d+r.dn_num);
-					if(p==0||d==0x3f3f3f3f) break;
-				}
-			}		
-		}
-		else{
-			int i=0;
-			p=0;
-			d=0x3f3f3f3f;
-			for(auto it:space_opponent){
-				board b_now=now->b;
-				if(it.apply(b_now)==board::legal){
-					now->next[i]=new tree_node(b_now,who,it);
-					tree_node r=pn_dfs(now->next[i]);
-					i++;
-					p=std::max(p,p+r.pn_num);
-					d=std::min(d,r.dn_num);
-					if(p==0x3f3f3f3f||d==0) break;
-				}
-			}
-		}
-		now->pn_num=p;
-		now->dn_num=d;
-		ret.pn_num=p;
-		ret.dn_num=d;
-		return ret;
-	}
+protected:
+	solver_type solver;
+	opening_book book;
 
-	void pn_search(){
-		pn_dfs(root);
-	}
+	int initial, grow, peak, decay;
+	bool by_amaf;
+	int pn_step, pn_moves, pn_replies;
 
-	// for debug
-	void dump_root(){
-		std::queue<tree_node *> q;
-		if(root) q.push(root);
-		
-		for(int i=0;i<100;i++){ 
-			if(root->next[i]&&root->next[i]->game_cnt!=0){
-				std::cout << root->next[i]->pos << " " << root->next[i]->win_cnt << " " << root->next[i]->game_cnt << '\n';
-			}
-		}
-		std::cout << '\n' << '\n';
-		
-		/*
-		while(q.size()!=0){
-			tree_node* now=q.front();
-			q.pop();
-			for(int i=0;i<100;i++){
-				if(now->next[i]&&now->next[i]->game_cnt!=0){
-					if(now->next[i]) q.push(now->next[i]);
-				}
-			}
-			std::cout << now->pos << " " <<  now->win_cnt << " " << now->game_cnt << '\n';
-		}
-		std::cout << '\n' << '\n';
-		*/
-	}
+	time_t timeout;
 
-	virtual void open_episode(const std::string& flag = "") {
-		step_cnt=0;
-		use_pns_threshold=0x3f3f3f3f;
-		use_pns_threshold_opponent=0x3f3f3f3f;
-		time_control=1000;
-	}
+	int budget;
+	int step_cnt;
+	int legal_cnt; // the legal moves of this player at the last search
+	int reply_cnt; // the legal replies of the opponent after the first legal move at the last search
+};
 
-	virtual action take_action(const board& state) {
-		//std::cout << state << '\n';
-		std::shuffle(space.begin(), space.end(), engine);
-		std::shuffle(space_opponent.begin(),space_opponent.end(),engine);
+/**
+ * the players of the search, as configurations of mcts_player
+ */
+class mtcs_uct_player : public mcts_player<uct_selection, random_playout, player_backup, no_solver> {
+public:
+	mtcs_uct_player(const std::string& args = "") : mcts_player("iterations=1000 decision=tree " + args) {}
+};
 
-		node_state.clear();
-		for(auto it:space) node_state[it]=std::make_pair(0,0);
+class mtcs_uct_rave_player : public mcts_player<uct_selection, random_playout, player_backup, no_solver> {
+public:
+	mtcs_uct_rave_player(const std::string& args = "") : mcts_player("iterations=10 grow=30 peak=600 decay=20 decision=amaf " + args) {}
+};
 
-		action::place best_move;		
-		
-		init(state,who);
-		step_cnt++;
-		//std::cout << use_pns_threshold << '\n';
-		//std::cout << use_pns_threshold_opponent << '\n';
-		if(true){
-			use_pns_threshold=0;
-			for(int i=0;i<time_control;i++) update();
-			//if(time_control<3000) time_control+=400;
-			//else time_control-=100;
-			//dump_root();
-			float best_win_rate=0;
-			bool cal_opponent=true;
-			for(int i=0;i<100;i++){ 
-				board t=root->b;
-				if(root->next[i]&&root->next[i]->pos.apply(t)==board::legal){
-					use_pns_threshold++;
-					if(cal_opponent){
-						use_pns_threshold_opponent=0;
-						for(auto it:space_opponent){
-							board test=t;
-							if(it.apply(test)==board::legal) use_pns_threshold_opponent++;
-						}
-						cal_opponent=false;
-					}
-					//std::cout << root->next[i]->pos << " " <<  node_state[root->next[i]->pos].first << " " << node_state[root->next[i]->pos].second << '\n';
-					/*
-					if(node_state[root->next[i]->pos].second!=0){
-						if((float)node_state[root->next[i]->pos].first/node_state[root->next[i]->pos].second>best_win_rate){
-							best_win_rate=(float)node_state[root->next[i]->pos].first/node_state[root->next[i]->pos].second;
-							best_move=root->next[i]->pos;
-						}
-					}
-					*/
-					
-					if((float)root->next[i]->win_cnt/root->next[i]->game_cnt>best_win_rate){
-						best_win_rate=(float)root->next[i]->win_cnt/root->next[i]->game_cnt;
-						best_move=root->next[i]->pos;
-					}
-					
-				}
-			}
-			/*
-			if(step_cnt>27){
-				std::cout << 123 << '\n';
-				init(state,who);
-				pn_search();
-				std::cout << root->pn_num << '\n';
-			}
-			*/
-		}
-		
-		return best_move;
-	}
+class mtcs_uct_rave_pn_player : public mcts_player<uct_selection, random_playout, player_backup, endgame_solver> {
+public:
+	mtcs_uct_rave_pn_player(const std::string& args = "") : mcts_player("iterations=500 grow=500 peak=5000 decay=200 decision=amaf " + args) {}
+};
 
-private:
-	std::vector<action::place> space;
-	std::vector<action::place> space_opponent;
-	std::vector<action::place> space1;
-	std::vector<action::place> space_opponent1;
-	board::piece_type who;
-	board::piece_type opponent;
-	std::map<action::place,std::pair<int,int>> node_state;
-	tree_node *root=nullptr;
+class mtcs_with_sample_rave_player : public mcts_player<flat_selection, random_playout, player_backup, no_solver> {
+public:
+	mtcs_with_sample_rave_player(const std::string& args = "") : mcts_player("iterations=2400 decision=amaf " + args) {}
+};
 
-	int use_pns_threshold=0x3f3f3f3f;
-	int use_pns_threshold_opponent=0x3f3f3f3f;
-	int time_control=1000;
-	int step_cnt=0;
+class black_player : public mcts_player<uct_selection, random_playout, player_backup, endgame_solver> {
+public:
+	black_player(const std::string& args = "") : mcts_player("iterations=500 grow=1000 peak=10000 decision=amaf " + args) {}
 };
 
 
@@ -1359,91 +706,22 @@ public:
 			space_opponent[i] = action::place(i, opponent);
 			space_opponent1.push_back(action::place(i,opponent));
 		}
+		solver.configure(meta);
+		if (meta.find("book") != meta.end()) book.open(std::string(meta["book"]));
 	}
 
-	struct tree_node{
-		tree_node* next[100]={nullptr};
-		int win_cnt=0;
-		int game_cnt=0;
-		board b;
-		board::piece_type w;
-		action::place pos;
-		int pn_num=1000;
-		int dn_num=1000;
-		tree_node(){}
-		tree_node(board b,board::piece_type w):b(b),w(w){}
-		tree_node(board b,board::piece_type w,action::place pos):b(b),w(w),pos(pos){}
-		bool is_leaf(){
-			bool t=true;
-			for(int i=0;i<100;i++){
-				if(next[i]) t=false; 
-			}
-			return t;
-		}
-	};
-
-	tree_node pn_dfs(tree_node* now){
-		tree_node ret;
-		int p,d;
-		if(now->w==who){
-			int i=0;
-			p=0x3f3f3f3f;
-			d=0;
-			for(auto it:space){
-				board b_now=now->b;
-				if(it.apply(b_now)==board::legal){
-					now->next[i]=new tree_node(b_now,opponent,it);
-					tree_node r=pn_dfs(now->next[i]);
-					i++;
-					p=std::min(p,r.pn_num);
-					d=std::max(d,d+r.dn_num);
-					if(p==0||d==0x3f3f3f3f) break;
-				}
-			}		
-		}
-		else{
-			int i=0;
-			p=0;
-			d=0x3f3f3f3f;
-			for(auto it:space_opponent){
-				board b_now=now->b;
-				if(it.apply(b_now)==board::legal){
-					now->next[i]=new tree_node(b_now,who,it);
-					tree_node r=pn_dfs(now->next[i]);
-					i++;
-					p=std::max(p,p+r.pn_num);
-					d=std::min(d,r.dn_num);
-					if(p==0x3f3f3f3f||d==0) break;
-				}
-			}
-		}
-		now->pn_num=p;
-		now->dn_num=d;
-		ret.pn_num=p;
-		ret.dn_num=d;
-		return ret;
-	}
-
-	void pn_search(){
-		pn_dfs(root);
+	// solve the position by proof-number search, see solver.h
+	void pn_search(const board& state){
+		solver.solve(state);
 	}
 
-	void init(const board& state,board::piece_type w){
-		std::queue<tree_node *> q;
-		if(root) q.push(root);
-		while(q.size()!=0){
-			tree_node* now=q.front();
-			q.pop();
-			for(int i=0;i<100;i++) if(now->next[i]) q.push(now->next[i]);
-			free(now);
-		}
-		root=new tree_node(state,w);
-	}
+	virtual void stop(bool flag = true) { solver.stop(flag); }
 
 	virtual void open_episode(const std::string& flag = "") {
 		step_cnt=0;
 		use_pns_threshold=0x3f3f3f3f;
 		use_pns_threshold_opponent=0x3f3f3f3f;
+		solver.clear();
 	}
 
 	virtual action take_action(const board& state) {
@@ -1453,25 +731,25 @@ public:
 
 		action::place best_move;		
 		
-		init(state,who);
 		step_cnt++;
+
+		// a position solved before, in this game or another, is played at once
+		int known=solver.lookup(state);
+		if(known!=-1) return action::place(known,who);
 		
 		if(step_cnt>29){
-			pn_search();
-			for(int i=0;i<100;i++){
-				board t=root->b;
-				if(root->next[i]&&root->next[i]->pos.apply(t)==board::legal){
-					if(root->next[i]->pn_num==0){
-						//std::cout << "has_ans" << '\n';
-						best_move=root->next[i]->pos;
-						return best_move;
-						break;
-					}
-					else{best_move=root->next[i]->pos;}
-				}
+			pn_search(state);
+			if(solver.proven_move()!=-1){
+				//std::cout << "has_ans" << '\n';
+				best_move=action::place(solver.proven_move(),who);
+				return best_move;
 			}
 		}
 
+		// the opening book, see book.h, and then the point-mirror move
+		int opening=book.probe(state);
+		if(opening!=-1) return action::place(opening,who);
+
 		//for(auto it:space) std::cout << it << '\n';
 		board m=state;
 		//std::cout << "_______________________" << '\n';
@@ -1506,428 +784,63 @@ private:
 	board::piece_type who;
 	board::piece_type opponent;
 	std::map<action::place,std::pair<int,int>> node_state;
-	tree_node *root=nullptr;
+	endgame_solver solver;
+	opening_book book;
 
 	int use_pns_threshold=0x3f3f3f3f;
 	int use_pns_threshold_opponent=0x3f3f3f3f;
 	int step_cnt=0;
 };
 
-class black_player : public random_agent {
-public:
-	black_player(const std::string& args = "") : random_agent("name=random role=unknown " + args),
-		space(board::size_x * board::size_y),space_opponent(board::size_x * board::size_y), who(board::empty) {
-		if (name().find_first_of("[]():; ") != std::string::npos)
-			throw std::invalid_argument("invalid name: " + name());
-		if (role() == "black"){
-			who = board::black;
-			opponent = board::white;
-		}
-		if (role() == "white"){
-			who = board::white;
-			opponent = board::black;
-		}
-		if (who == board::empty)
-			throw std::invalid_argument("invalid role: " + role());
-		for (size_t i = 0; i < space.size(); i++){
-			space[i] = action::place(i, who);
-			space1.push_back(action::place(i,who));
-			space_opponent[i] = action::place(i, opponent);
-			space_opponent1.push_back(action::place(i,opponent));
-		}
-	}
-
-	static int myrandom (int i) { return std::rand()%i;}
-
-	// simulate one game
-	bool simulation(const board& now,board::piece_type a){
-		bool ch=true;
-		board next=now;
-		int stat;
-		if(a==who) stat=1;
-		else stat=0;
-		std::srand(time(0));
-		std::random_shuffle(space1.begin(),space1.end(),myrandom);
-		std::random_shuffle(space_opponent1.begin(),space_opponent1.end(),myrandom);
-		
-		std::vector<action::place> rem;
-
-		for(int i=1;i<=74;i++){
-			if(i%2){
-				if(stat){
-					for (const action::place& move : space1) {
-						board ne=next;
-						if (move.apply(ne) == board::legal){
-							rem.push_back(move);
-							node_state[move].second++;
-							next=ne;
-							goto L_nextround;
-						}
-					}
-					ch=false;
-					break;
-				}
-				else{
-					for (const action::place& move : space_opponent1) {
-						board ne=next;
-						if (move.apply(ne) == board::legal){
-							next=ne;
-							goto L_nextround;
-						}
-					}
-					ch=true;
-					break;
-				}
-			}
-			else{
-				if(stat){
-					for (const action::place& move : space_opponent1) {
-						board ne=next;
-						if (move.apply(ne) == board::legal){
-							next=ne;
-							goto L_nextround;
-						}
-					}
-					ch=true;
-					break;
-				}
-				else{
-					for (const action::place& move : space1) {
-						board ne=next;
-						if (move.apply(ne) == board::legal){
-							rem.push_back(move);
-							node_state[move].second++;
-							next=ne;
-							goto L_nextround;
-						}
-					}
-					ch=false;
-					break;
-				}
-			}
-			L_nextround:;
-		}
-		
-		if(ch) for(auto it:rem) node_state[it].first++;
-		
-		return ch;
-	}
-
-	struct tree_node{
-		tree_node* next[100]={nullptr};
-		int win_cnt=0;
-		int game_cnt=0;
-		board b;
-		board::piece_type w;
-		action::place pos;
-		int pn_num=1000;
-		int dn_num=1000;
-		tree_node(){}
-		tree_node(board b,board::piece_type w):b(b),w(w){}
-		tree_node(board b,board::piece_type w,action::place pos):b(b),w(w),pos(pos){}
-		bool is_leaf(){
-			bool t=true;
-			for(int i=0;i<100;i++){
-				if(next[i]) t=false; 
-			}
-			return t;
-		}
-	};
-
-	// initial mtcs tree
-	void init(const board& state,board::piece_type w){
-		std::queue<tree_node *> q;
-		if(root) q.push(root);
-		while(q.size()!=0){
-			tree_node* now=q.front();
-			q.pop();
-			for(int i=0;i<100;i++) if(now->next[i]) q.push(now->next[i]);
-			free(now);
-		}
-		root=new tree_node(state,w);
-	}
-
-	// mtcg update
-	void update(){
-		std::queue<tree_node *> q;
-		tree_node *now=root;
-		bool not_end=true;
-		if(now){
-			// find leaf
-			q.push(now);
-			while(!now->is_leaf()){
-				float score=0;
-				float max_score=0;
-				int max_ind=0;
-				not_end=false;
-				for(int i=0;i<100;i++){
-					if(now->next[i]){
-						board t=now->b;
-						if(now->next[i]->pos.apply(t)==board::legal){
-							not_end=true;
-							//std::cout << now->next[i]->pos << '\n';
-							if(now->next[i]->game_cnt==0) score=100000;
-							else score= (float)now->next[i]->win_cnt/now->next[i]->game_cnt + sqrt(log(now->game_cnt)/now->next[i]->game_cnt);
-							//std::cout << i << " " << score << '\n';
-							if(score>max_score){
-								//std::cout << i << " " << score << " " << max_score << '\n';
-								max_score=score;
-								max_ind=i;
-							}
-						}
-					}
-				}
-				if(not_end){
-					now=now->next[max_ind];
-					q.push(now);
-				}
-				else break;
-			}
-
-			// expension
-			if(not_end){
-				if(now->w==who){
-					int i=0;
-					for(auto it:space){
-						board b_now=now->b;
-						it.apply(b_now);
-						now->next[i]=new tree_node(b_now,opponent,it);
-						i++;
-					}
-				}
-				else{
-					int i=0;
-					for(auto it:space_opponent){
-						board b_now=now->b;
-						it.apply(b_now);
-						now->next[i]=new tree_node(b_now,who,it);
-						i++;
-					}
-				}
-			}
-
-			// simulation
-			bool win=false;
-			if(not_end){
-				for(int i=0;i<100;i++){
-					board t=now->b;
-					if(now->next[i]){
-						if(now->next[i]->pos.apply(t)==board::legal){
-							now=now->next[i];
-							q.push(now);
-							win=simulation(now->b,now->w);
-							break;
-						}
-					}
-				}
-			}
-			else{
-				q.push(now);
-				win=simulation(now->b,now->w);
-			}
-			// propagation back
-			while(q.size()!=0){
-				tree_node* now=q.front();
-				q.pop();
-				node_state[now->pos].second++;
-				now->game_cnt++;
-				if(win){
-					node_state[now->pos].first++;
-					now->win_cnt++;
-				}
-			}
-
-		}
-	}
-
-	tree_node pn_dfs(tree_node* now){
-		tree_node ret;
-		int p,d;
-		if(now->w==who){
-			int i=0;
-			p=0x3f3f3f3f;
-			d=0;
-			for(auto it:space){
-				board b_now=now->b;
-				if(it.apply(b_now)==board::legal){
-					now->next[i]=new tree_node(b_now,opponent,it);
-					tree_node r=pn_dfs(now->next[i]);
-					i++;
-					p=std::min(p,r.pn_num);
-					d=std::max(d,d+r.dn_num);
-					if(p==0||d==0x3f3f3f3f) break;
-				}
-			}		
-		}
-		else{
-			int i=0;
-			p=0;
-			d=0x3f3f3f3f;
-			for(auto it:space_opponent){
-				board b_now=now->b;
-				if(it.apply(b_now)==board::legal){
-					now->next[i]=new tree_node(b_now,who,it);
-					tree_node r=pn_dfs(now->next[i]);
-					i++;
-					p=std::max(p,p+r.pn_num);
-					d=std::min(d,r.dn_num);
-					if(p==0x3f3f3f3f||d==0) break;
-				}
-			}
-		}
-		now->pn_num=p;
-		now->dn_num=d;
-		ret.pn_num=p;
-		ret.dn_num=d;
-		return ret;
-	}
-
-	void pn_search(){
-		pn_dfs(root);
-	}
-
-	// for debug
-	void dump_root(){
-		std::queue<tree_node *> q;
-		if(root) q.push(root);
-		
-		for(int i=0;i<100;i++){ 
-			if(root->next[i]&&root->next[i]->game_cnt!=0){
-				std::cout << root->next[i]->pos << " " << root->next[i]->win_cnt << " " << root->next[i]->game_cnt << '\n';
-			}
-		}
-		std::cout << '\n' << '\n';
-		
-		/*
-		while(q.size()!=0){
-			tree_node* now=q.front();
-			q.pop();
-			for(int i=0;i<100;i++){
-				if(now->next[i]&&now->next[i]->game_cnt!=0){
-					if(now->next[i]) q.push(now->next[i]);
-				}
-			}
-			std::cout << now->pos << " " <<  now->win_cnt << " " << now->game_cnt << '\n';
-		}
-		std::cout << '\n' << '\n';
-		*/
-	}
-
-	virtual void open_episode(const std::string& flag = "") {
-		step_cnt=0;
-		use_pns_threshold=0x3f3f3f3f;
-		use_pns_threshold_opponent=0x3f3f3f3f;
-		time_control=500;
-		down=false;
-	}
-
-	virtual action take_action(const board& state) {
-		//std::cout << state << '\n';
-		std::shuffle(space.begin(), space.end(), engine);
-		std::shuffle(space_opponent.begin(),space_opponent.end(),engine);
-
-		node_state.clear();
-		for(auto it:space) node_state[it]=std::make_pair(0,0);
-
-		action::place best_move;		
-		
-		init(state,who);
-		step_cnt++;
-		//std::cout << use_pns_threshold << '\n';
-		//std::cout << use_pns_threshold_opponent << '\n';
-
-		for(int i=0;i<time_control;i++) update();
-		if(down==false&&time_control<10000) time_control+=1000;
-		else{
-			down=true;
-			//time_control-=50;
-		}
-
-		if(step_cnt<5){
-			board m=state;
-			m.reflect_horizontal();
-			m.reflect_vertical();
-			for(int i=0;i<81;i++){
-				if(state(i)==board::piece_type::empty && m(i)!=board::piece_type::empty){
-					board t=state;
-					if(action::place(i,who).apply(t)==board::legal) return action::place(i,who);
-				}
-			}
-		}
-		
-		if(step_cnt<=40&&!(use_pns_threshold<12&&use_pns_threshold_opponent<15)){
-			use_pns_threshold=0;
-
-			//dump_root();
-			float best_win_rate=0;
-			bool cal_opponent=true;
-			for(int i=0;i<100;i++){ 
-				board t=root->b;
-				if(root->next[i]&&root->next[i]->pos.apply(t)==board::legal){
-					use_pns_threshold++;
-					if(cal_opponent){
-						use_pns_threshold_opponent=0;
-						for(auto it:space_opponent){
-							board test=t;
-							if(it.apply(test)==board::legal) use_pns_threshold_opponent++;
-						}
-						cal_opponent=false;
-					}
-					//std::cout << root->next[i]->pos << " " <<  node_state[root->next[i]->pos].first << " " << node_state[root->next[i]->pos].second << '\n';
-					if(node_state[root->next[i]->pos].second!=0){
-						if((float)node_state[root->next[i]->pos].first/node_state[root->next[i]->pos].second>best_win_rate){
-							best_win_rate=(float)node_state[root->next[i]->pos].first/node_state[root->next[i]->pos].second;
-							best_move=root->next[i]->pos;
-						}
-					}
-					/*
-					if((float)root->next[i]->win_cnt/root->next[i]->game_cnt>best_win_rate){
-						best_win_rate=(float)root->next[i]->win_cnt/root->next[i]->game_cnt;
-						best_move=root->next[i]->pos;
-					}
-					*/	
-				}
-			}
-			/*
-			if(step_cnt>27){
-				std::cout << 123 << '\n';
-				init(state,who);
-				pn_search();
-				std::cout << root->pn_num << '\n';
-			}
-			*/
-		}
-		else{
-			pn_search();
-			//std::cout << "pn_num: " << root->pn_num << '\n';
-			for(int i=0;i<100;i++){
-				board t=root->b;
-				if(root->next[i]&&root->next[i]->pos.apply(t)==board::legal){
-					if(root->next[i]->pn_num==0){
-						std::cout << "has_ans" << '\n';
-						best_move=root->next[i]->pos;
-						break;
-					}
-					else{best_move=root->next[i]->pos;}
-				}
-			}
-		}
-		return best_move;
-	}
+/**
+ * assemble "search=mcts" from "selection=uct|rave|flat", "backup=player|negamax", and "solver=pns|dfpn" (none by default)
+ */
+template<class selection, class backup>
+std::unique_ptr<agent> make_mcts_player(const std::string& args, const std::string& solver) {
+	if (solver.empty() || solver == "none")
+		return std::unique_ptr<agent>(new mcts_player<selection, random_playout, backup, no_solver>(args));
+	return std::unique_ptr<agent>(new mcts_player<selection, random_playout, backup, endgame_solver>(args));
+}
+template<class selection>
+std::unique_ptr<agent> make_mcts_player(const std::string& args, const std::string& backup, const std::string& solver) {
+	if (backup == "negamax") return make_mcts_player<selection, negamax_backup>(args, solver);
+	return make_mcts_player<selection, player_backup>(args, solver);
+}
 
-private:
-	std::vector<action::place> space;
-	std::vector<action::place> space_opponent;
-	std::vector<action::place> space1;
-	std::vector<action::place> space_opponent1;
-	board::piece_type who;
-	board::piece_type opponent;
-	std::map<action::place,std::pair<int,int>> node_state;
-	tree_node *root=nullptr;
+/**
+ * the arguments of a player of a worker, seeded by the worker index, offset from the given seed if any
+ */
+inline std::string seeded_args(const std::string& args, size_t id) {
+	size_t seed = 0, pos = (" " + args).rfind(" seed=");
+	if (pos != std::string::npos) seed = std::stoull(args.substr(pos + 5));
+	return args + " seed=" + std::to_string(seed + id);
+}
 
-	int use_pns_threshold=0x3f3f3f3f;
-	int use_pns_threshold_opponent=0x3f3f3f3f;
-	int time_control=500;
-	int step_cnt=0;
-	bool down=false;
-};
+/**
+ * create the player given by "search=..." in the arguments, which is one of
+ *   "mcts" (see make_mcts_player), "uct", "rave", "rave-pn", "sample", "alpha-beta", "random", "black", and "white"
+ * the default player of the role (black_player or white_player) is created if no search is given
+ */
+inline std::unique_ptr<agent> make_player(const std::string& args) {
+	std::map<std::string, std::string> meta;
+	std::stringstream ss(args);
+	for (std::string pair; ss >> pair; ) meta[pair.substr(0, pair.find('='))] = pair.substr(pair.find('=') + 1);
+	std::string search = meta.count("search") ? meta["search"] : meta["role"];
+	std::transform(search.begin(), search.end(), search.begin(), ::tolower);
+
+	if (search == "mcts") {
+		std::string selection = meta["selection"];
+		if (selection == "rave") return make_mcts_player<rave_selection>(args, meta["backup"], meta["solver"]);
+		if (selection == "flat") return make_mcts_player<flat_selection>(args, meta["backup"], meta["solver"]);
+		return make_mcts_player<uct_selection>(args, meta["backup"], meta["solver"]);
+	}
+	if (search == "uct") return std::unique_ptr<agent>(new mtcs_uct_player(args));
+	if (search == "rave") return std::unique_ptr<agent>(new mtcs_uct_rave_player(args));
+	if (search == "rave-pn") return std::unique_ptr<agent>(new mtcs_uct_rave_pn_player(args));
+	if (search == "sample") return std::unique_ptr<agent>(new mtcs_with_sample_rave_player(args));
+	if (search == "alpha-beta" || search == "alphabeta") return std::unique_ptr<agent>(new alphabeta_player(args));
+	if (search == "random") return std::unique_ptr<agent>(new random_player(args));
+	if (search == "black") return std::unique_ptr<agent>(new black_player(args));
+	if (search == "white") return std::unique_ptr<agent>(new white_player(args));
+	throw std::invalid_argument("invalid search: " + search);
+}
@@ -0,0 +1,267 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * alphabeta.h: Alpha-beta search with iterative deepening
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <memory>
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+#include <algorithm>
+#include <cstdlib>
+#include "board.h"
+#include "action.h"
+#include "cancel.h"
+
+/**
+ * negascout (principal variation search) with iterative deepening
+ *
+ * a leaf is evaluated by the mobility difference, i.e., the legal moves of the side to move minus those of the opponent,
+ * and a position without legal moves is lost for its side to move, scored by its distance so that faster wins are preferred
+ * the moves are ordered by the move of the transposition table, the killer moves of the ply, and the history heuristic
+ * the transposition table is lock-free, an entry stores its key xor-ed with its data so that a torn entry fails the check
+ * the search stops at the deadline, the depth limit, or a cancellation (see cancel_token),
+ * and the result of the last completed iteration is used, where a search again starts from the table
+ */
+class alphabeta_search {
+public:
+	enum { win_score = 10000, max_ply = board::size_x * board::size_y };
+
+public:
+	alphabeta_search(size_t entries = 1 << 20, time_t millisec = 1000, int depth = max_ply)
+		: entries(entries), millisec(millisec), max_depth(depth), best(-1), best_score(0), completed(0),
+		  nodes(0), elapsed(0), aborted(false) {
+		clear();
+	}
+
+	/**
+	 * limit the time of a search in milliseconds, where a non-positive time is no deadline as of cancel_token,
+	 * and the search is then only bounded by the depth limit or a cancellation
+	 */
+	void limit_time(time_t ms) { millisec = ms; }
+	void limit_depth(int depth) { max_depth = std::max(depth, 1); }
+	void limit_memory(size_t bytes) { entries = std::max<size_t>(bytes / sizeof(entry), 1); table.reset(); }
+
+	/**
+	 * request the running search to stop as at the deadline, which may be called from another thread,
+	 * and the request holds until it is cleared by stop(false)
+	 */
+	void stop(bool flag = true) { token.cancel(flag); }
+
+	/**
+	 * forget the transposition table and the move ordering heuristics, e.g., at the beginning of a new game
+	 */
+	void clear() {
+		if (table) for (size_t i = 0; i < table_size(); i++) table[i].check = table[i].data = 0;
+		std::fill(&history[0][0], &history[0][0] + 2 * max_ply, 0);
+		std::fill(&killers[0][0], &killers[0][0] + 2 * (max_ply + 1), -1);
+	}
+
+	/**
+	 * search the position for its side to move by iterative deepening
+	 * return the best move of the last completed iteration, or -1 if there is no legal move
+	 */
+	int search(const board& state) {
+		if (!table) {
+			table.reset(new entry[table_size()]());
+		}
+		auto start = std::chrono::steady_clock::now();
+		token.expire_after(millisec);
+		nodes = 0;
+		aborted = false;
+		completed = 0;
+		best = -1;
+		best_score = 0;
+		for (int i = 0; i < max_ply && best == -1; i++) { // a fallback in case the first iteration is aborted
+			board after = state;
+			if (action::place(i, state.info().who_take_turns).apply(after) == board::legal) best = i;
+		}
+
+		uint64_t key = state.hash();
+		for (int depth = 1; depth <= max_depth && best != -1; depth++) {
+			root_move = -1;
+			int score = negascout(state, key, depth, -win_score - 1, win_score + 1, 0);
+			if (aborted) break;
+			completed = depth;
+			best_score = score;
+			if (root_move != -1) best = root_move;
+			if (std::abs(score) >= win_score - max_ply) break; // proven
+		}
+		elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		return best;
+	}
+
+	int score() const { return best_score; }
+	int depth() const { return completed; }
+	size_t node_count() const { return nodes; }
+	double seconds() const { return elapsed; }
+	double nodes_per_sec() const { return elapsed > 0 ? nodes / elapsed : 0; }
+	size_t memory() const { return table_size() * sizeof(entry); }
+
+private:
+	enum bound_type { exact = 0, lower = 1, upper = 2 };
+
+	/**
+	 * an entry of the transposition table, where data packs the score, the depth, the bound, and the best move
+	 */
+	struct entry {
+		std::atomic<uint64_t> check; // key ^ data
+		std::atomic<uint64_t> data;
+	};
+
+	static uint64_t pack(int score, int depth, int bound, int move) {
+		return uint64_t(uint16_t(int16_t(score))) | (uint64_t(uint8_t(depth)) << 16) | (uint64_t(bound) << 24) | (uint64_t(uint8_t(move)) << 32);
+	}
+	static int score_of(uint64_t data) { return int16_t(data & 0xffff); }
+	static int depth_of(uint64_t data) { return (data >> 16) & 0xff; }
+	static int bound_of(uint64_t data) { return (data >> 24) & 0x3; }
+	static int move_of(uint64_t data) { return int8_t((data >> 32) & 0xff); }
+
+	size_t table_size() const {
+		size_t size = 1;
+		while (size * 2 <= entries) size *= 2;
+		return size;
+	}
+
+	bool probe(uint64_t key, uint64_t& data) const {
+		const entry& e = table[key & (table_size() - 1)];
+		data = e.data.load(std::memory_order_relaxed);
+		return (e.check.load(std::memory_order_relaxed) ^ data) == key;
+	}
+	void store(uint64_t key, uint64_t data) {
+		entry& e = table[key & (table_size() - 1)];
+		e.check.store(key ^ data, std::memory_order_relaxed);
+		e.data.store(data, std::memory_order_relaxed);
+	}
+
+	/**
+	 * the number of legal moves of a side
+	 */
+	static int mobility(const board& b, unsigned who) {
+		board test = b;
+		test.info({static_cast<board::piece_type>(who)});
+		int count = 0;
+		for (int i = 0; i < max_ply; i++) {
+			board after = test;
+			if (action::place(i, who).apply(after) == board::legal) count++;
+		}
+		return count;
+	}
+
+	/**
+	 * negascout from the side to move, with mate scores relative to the root
+	 */
+	int negascout(const board& b, uint64_t key, int depth, int alpha, int beta, int ply) {
+		if (token.poll(++nodes)) aborted = true;
+		if (aborted) return 0;
+
+		int tt_move = -1;
+		uint64_t data;
+		if (probe(key, data)) {
+			tt_move = move_of(data);
+			if (ply > 0 && depth_of(data) >= depth) {
+				int score = from_table(score_of(data), ply);
+				if (bound_of(data) == exact) return score;
+				if (bound_of(data) == lower) alpha = std::max(alpha, score);
+				if (bound_of(data) == upper) beta = std::min(beta, score);
+				if (alpha >= beta) return score;
+			}
+		}
+
+		unsigned who = b.info().who_take_turns;
+		int moves[max_ply], order[max_ply];
+		int count = 0;
+		for (int i = 0; i < max_ply; i++) {
+			board after = b;
+			if (action::place(i, who).apply(after) != board::legal) continue;
+			moves[count] = i;
+			if (i == tt_move) order[count] = 1 << 30;
+			else if (i == killers[ply][0]) order[count] = 1 << 29;
+			else if (i == killers[ply][1]) order[count] = 1 << 28;
+			else order[count] = history[who - 1][i];
+			count++;
+		}
+		if (count == 0) return -win_score + ply; // no legal move, the side to move loses
+		if (depth == 0) return count - mobility(b, 3u - who);
+
+		int alpha_orig = alpha, best_score = -win_score - 1, best_move = -1;
+		for (int k = 0; k < count; k++) {
+			// pick the next move by the order, which is cheaper than sorting since cutoffs come early
+			int pick = k;
+			for (int j = k + 1; j < count; j++) if (order[j] > order[pick]) pick = j;
+			std::swap(moves[k], moves[pick]);
+			std::swap(order[k], order[pick]);
+
+			int move = moves[k];
+			board after = b;
+			board::point p(move);
+			after[p.x][p.y] = who;
+			after.info({static_cast<board::piece_type>(3u - who)});
+			uint64_t next = key ^ board::zobrist(move, who) ^ board::zobrist_turn();
+
+			int score;
+			if (k == 0) {
+				score = -negascout(after, next, depth - 1, -beta, -alpha, ply + 1);
+			} else {
+				score = -negascout(after, next, depth - 1, -alpha - 1, -alpha, ply + 1); // null window
+				if (score > alpha && score < beta) score = -negascout(after, next, depth - 1, -beta, -score, ply + 1);
+			}
+			if (aborted) return 0;
+
+			if (score > best_score) {
+				best_score = score;
+				best_move = move;
+				if (ply == 0) root_move = move;
+			}
+			if (score > alpha) alpha = score;
+			if (alpha >= beta) {
+				if (killers[ply][0] != move) {
+					killers[ply][1] = killers[ply][0];
+					killers[ply][0] = move;
+				}
+				history[who - 1][move] += depth * depth;
+				break;
+			}
+		}
+
+		int bound = best_score <= alpha_orig ? upper : best_score >= beta ? lower : exact;
+		store(key, pack(to_table(best_score, ply), depth, bound, best_move));
+		return best_score;
+	}
+
+	/**
+	 * mate scores are stored relative to the node, and restored relative to the root
+	 */
+	static int to_table(int score, int ply) {
+		if (score >= win_score - max_ply) return score + ply;
+		if (score <= -win_score + max_ply) return score - ply;
+		return score;
+	}
+	static int from_table(int score, int ply) {
+		if (score >= win_score - max_ply) return score - ply;
+		if (score <= -win_score + max_ply) return score + ply;
+		return score;
+	}
+
+private:
+	std::unique_ptr<entry[]> table;
+	size_t entries;
+	time_t millisec;
+	int max_depth;
+	int history[2][max_ply];
+	int killers[max_ply + 1][2];
+
+	int best;
+	int best_score;
+	int completed;
+	int root_move;
+	size_t nodes;
+	double elapsed;
+	bool aborted;
+	cancel_token token;
+};
@@ -0,0 +1,201 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * analysis.h: Batch re-analysis of saved games
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include "board.h"
+#include "action.h"
+#include "agent.h"
+#include "episode.h"
+#include "archive.h"
+
+/**
+ * the evaluation of a position of a saved game, i.e., the move played and the move preferred by the search,
+ * with their win rates for the side to move, where the rate of a move not visited by the search is -1
+ */
+struct evaluation {
+	uint32_t episode; // the index of the episode in the saved file
+	uint8_t ply;      // the index of the move in the episode
+	uint8_t played;
+	uint8_t best;
+	int8_t proof;     // the proof of the position for the side to move, see mcts_tree::proof_type
+	float played_rate;
+	float best_rate;
+};
+
+/**
+ * re-analysis of the saved games, where every position is searched by MCTS with a fixed budget
+ *
+ * the episodes are streamed from a saved statistic file (in either format) in batches, the positions of a batch
+ * are shared by the threads through a counter, and every thread has its own engines
+ * the evaluations are appended to the output file in the order of the positions, after a header,
+ * so that an interrupted analysis is resumed by "offset=N", the number of episodes already analyzed
+ *
+ * the arguments are "output=path" (the saved file with ".eval" by default), "iterations=N" (20000),
+ * "threads=N", "offset=N" (0), "batch=N" (256 episodes), and the arguments of the engines, e.g., "seed=N"
+ */
+class game_analyzer {
+public:
+	game_analyzer(const std::string& args = "") : iterations(20000), threads(1), offset(0), batch(256) {
+		std::stringstream ss(args);
+		for (std::string pair; ss >> pair; ) meta[pair.substr(0, pair.find('='))] = pair.substr(pair.find('=') + 1);
+		if (meta.count("iterations")) iterations = std::stoi(meta["iterations"]);
+		threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+		if (meta.count("threads")) threads = std::max<size_t>(std::stoull(meta["threads"]), 1);
+		if (meta.count("offset")) offset = std::stoull(meta["offset"]);
+		if (meta.count("batch")) batch = std::max<size_t>(std::stoull(meta["batch"]), 1);
+		engine_args = args;
+	}
+
+	/**
+	 * analyze the episodes of a saved file from the offset
+	 * return the number of analyzed episodes, or -1 if a file cannot be opened
+	 */
+	long run(const std::string& path) {
+		std::ifstream text;
+		episode_reader binary;
+		bool is_binary = episode_archive::detect(path);
+		if (is_binary ? !binary.open(path) : (text.open(path, std::ios::in), !text.is_open())) return -1;
+		std::string line;
+		auto next = [&](episode& ep) {
+			if (is_binary) return binary.read(ep);
+			if (!std::getline(text, line) || line.empty()) return false;
+			return ep.parse(line.data(), line.data() + line.size());
+		};
+		episode skip;
+		if (!is_binary || !binary.seek(offset)) {
+			for (size_t i = 0; i < offset && next(skip); i++);
+		}
+
+		std::string output = meta.count("output") ? meta["output"] : path + ".eval";
+		std::ofstream out(output, std::ios::out | std::ios::binary | (offset ? std::ios::app : std::ios::trunc));
+		if (!out.is_open()) return -1;
+		if (out.seekp(0, std::ios::end).tellp() == 0) {
+			layout h;
+			std::memcpy(h.magic, magic(), sizeof(h.magic));
+			h.iterations = iterations;
+			h.record = sizeof(evaluation);
+			out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+		}
+
+		std::vector<std::unique_ptr<mcts_agent<>>> engines;
+		for (size_t i = 0; i < threads; i++) {
+			std::string seed = " seed=" + std::to_string(i);
+			engines.emplace_back(new mcts_agent<>("role=black " + engine_args + seed));
+			engines.emplace_back(new mcts_agent<>("role=white " + engine_args + seed));
+		}
+
+		long analyzed = 0;
+		std::vector<episode> episodes;
+		std::vector<position> positions;
+		std::vector<evaluation> results;
+		for (bool more = true; more; ) {
+			episodes.clear();
+			for (episode ep; episodes.size() < batch && (more = next(ep)); ) episodes.push_back(std::move(ep));
+			if (episodes.empty()) break;
+
+			positions.clear();
+			for (size_t e = 0; e < episodes.size(); e++) {
+				board state;
+				std::vector<action> moves = episodes[e].actions();
+				for (size_t ply = 0; ply < moves.size(); ply++) {
+					positions.push_back({ uint32_t(offset + analyzed + e), uint8_t(ply), action::place(moves[ply]).position().i, state });
+					if (moves[ply].apply(state) != board::legal) break;
+				}
+			}
+
+			results.resize(positions.size());
+			std::atomic<size_t> index(0);
+			auto work = [&](size_t id) {
+				for (size_t k; (k = index++) < positions.size(); ) {
+					const position& p = positions[k];
+					board::piece_type who = static_cast<board::piece_type>(p.state.info().who_take_turns);
+					results[k] = evaluate(*engines[id * 2 + (who == board::black ? 0 : 1)], p);
+				}
+			};
+			std::vector<std::thread> workers;
+			for (size_t i = 1; i < std::min(threads, positions.size()); i++) workers.emplace_back(work, i);
+			work(0);
+			for (std::thread& worker : workers) worker.join();
+
+			out.write(reinterpret_cast<const char*>(results.data()), results.size() * sizeof(evaluation));
+			out.flush();
+			analyzed += episodes.size();
+			std::cerr << "analyzed " << offset + analyzed << " episodes" << std::endl;
+		}
+		return out ? analyzed : -1;
+	}
+
+	/**
+	 * read the evaluations of an output file, return false if it is not an output file
+	 */
+	static bool load(const std::string& path, std::vector<evaluation>& list) {
+		std::ifstream in(path, std::ios::in | std::ios::binary);
+		layout h;
+		if (!in.read(reinterpret_cast<char*>(&h), sizeof(h))) return false;
+		if (std::memcmp(h.magic, magic(), sizeof(h.magic)) != 0 || h.record != sizeof(evaluation)) return false;
+		for (evaluation e; in.read(reinterpret_cast<char*>(&e), sizeof(e)); ) list.push_back(e);
+		return true;
+	}
+
+private:
+	struct layout {
+		char magic[8];
+		uint32_t iterations; // the budget of a position
+		uint32_t record;     // the size of a record
+	};
+
+	struct position {
+		uint32_t episode;
+		uint8_t ply;
+		int played;
+		board state;
+	};
+
+	static const char* magic() { return "NOGOAN01"; }
+
+	evaluation evaluate(mcts_agent<>& engine, const position& p) {
+		board::piece_type who = static_cast<board::piece_type>(p.state.info().who_take_turns);
+		engine.clear_statistics(); // every position is evaluated on its own, regardless of the order
+		engine.init_tree(p.state, who);
+		engine.search(iterations);
+
+		evaluation e = { p.episode, p.ply, uint8_t(p.played), uint8_t(p.played), engine.last_search().result, -1, -1 };
+		int best_games = 0;
+		for (int i = 0; i < board::size_x * board::size_y; i++) {
+			std::pair<int, int> s = engine.root_stat(i);
+			if (s.second == 0) continue;
+			float rate = float(s.first) / s.second;
+			if (i == p.played) e.played_rate = rate;
+			if (s.second > best_games) {
+				best_games = s.second;
+				e.best = i;
+				e.best_rate = rate;
+			}
+		}
+		return e;
+	}
+
+private:
+	std::map<std::string, std::string> meta;
+	std::string engine_args;
+	int iterations;
+	size_t threads;
+	size_t offset;
+	size_t batch;
+};
@@ -0,0 +1,347 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * archive.h: Compact binary format of episodes with streaming writer and reader
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstdint>
+#include <cstring>
+#include "board.h"
+#include "action.h"
+#include "episode.h"
+
+/**
+ * the binary format of episodes, a compact alternative to the text format of episode
+ *
+ * the file is a header, the episodes, and an index of the offsets of every block of episodes
+ * an episode holds its open and close time, the names of the players, the winner, and the moves with their time
+ * in microseconds and the counters of their searches (see search_info), where the counters are omitted if all are zero,
+ * a move is a byte of its position and color (0x80 for white), and the integers are varints (LEB128)
+ * the files of the first version, whose moves have their time in milliseconds only, are still readable
+ * the index is appended when the writer is closed, so that a file without the index, e.g., of an interrupted run,
+ * can still be read from its beginning
+ */
+class episode_archive {
+public:
+	/**
+	 * whether a file is in the binary format, by its header
+	 */
+	static bool detect(const std::string& path) {
+		std::ifstream in(path, std::ios::in | std::ios::binary);
+		layout h;
+		return in.read(reinterpret_cast<char*>(&h), sizeof(h)) && version(h);
+	}
+
+	/**
+	 * whether a file should be written in the binary format, by its extension ".bin"
+	 */
+	static bool binary_name(const std::string& path) {
+		return path.size() >= 4 && path.compare(path.size() - 4, 4, ".bin") == 0;
+	}
+
+protected:
+	struct layout {
+		char magic[8];
+		uint16_t size_x;
+		uint16_t size_y;
+		uint32_t block;   // the episodes of an index entry
+	};
+	struct trailer {
+		uint64_t index;   // the offset of the index
+		char magic[8];
+	};
+	enum tag_type { episode_tag = 'E', index_tag = 'I' };
+
+	static const char* magic() { return "NOGOEP02"; }
+	static unsigned version(const layout& h) {
+		if (std::memcmp(h.magic, magic(), sizeof(h.magic) - 1) != 0) return 0;
+		return h.magic[7] == '1' || h.magic[7] == '2' ? h.magic[7] - '0' : 0;
+	}
+	static const char* index_magic() { return "NOGOIDX1"; }
+
+	static void put(std::string& buf, uint64_t v) {
+		for (; v >= 0x80; v >>= 7) buf.push_back(char(v | 0x80));
+		buf.push_back(char(v));
+	}
+	static void put(std::string& buf, const std::string& s) {
+		put(buf, s.size());
+		buf.append(s);
+	}
+	static bool get(std::istream& in, uint64_t& v) {
+		v = 0;
+		for (unsigned shift = 0; shift < 64; shift += 7) {
+			int c = in.get();
+			if (c == EOF) return false;
+			v |= uint64_t(c & 0x7f) << shift;
+			if (!(c & 0x80)) return true;
+		}
+		return false;
+	}
+	static bool get(std::istream& in, std::string& s) {
+		uint64_t size;
+		if (!get(in, size)) return false;
+		s.resize(size);
+		return in.read(&s[0], size) || size == 0;
+	}
+
+	/**
+	 * a signed integer is zigzag encoded, e.g., the duration of an episode which is not closed yet
+	 */
+	static uint64_t zigzag(int64_t v) { return (uint64_t(v) << 1) ^ uint64_t(v >> 63); }
+	static int64_t unzigzag(uint64_t v) { return int64_t(v >> 1) ^ -int64_t(v & 1); }
+};
+
+/**
+ * streaming writer of the binary format
+ */
+class episode_writer : public episode_archive {
+public:
+	episode_writer() : block(0), count(0), offset(0) {}
+	~episode_writer() { close(); }
+
+	/**
+	 * create the file, where every block of episodes has an index entry
+	 */
+	bool open(const std::string& path, uint32_t block = 1024) {
+		close();
+		out.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!out.is_open()) return false;
+		layout h;
+		std::memcpy(h.magic, magic(), sizeof(h.magic));
+		h.size_x = board::size_x;
+		h.size_y = board::size_y;
+		h.block = this->block = std::max<uint32_t>(block, 1);
+		out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+		count = 0;
+		offset = sizeof(h);
+		index.clear();
+		return bool(out);
+	}
+
+	bool write(const episode& ep) {
+		if (count % block == 0) index.push_back(offset);
+		buf.assign(1, char(episode_tag));
+		put(buf, ep.ep_open.when);
+		put(buf, zigzag(ep.ep_close.when - ep.ep_open.when));
+		put(buf, ep.ep_open.tag);
+		// the winner is usually one of the names, i.e., "black:white"
+		const std::string& names = ep.ep_open.tag;
+		if (ep.ep_close.tag == names.substr(0, names.find(':'))) {
+			buf.push_back(1);
+		} else if (names.find(':') != std::string::npos && ep.ep_close.tag == names.substr(names.find(':') + 1)) {
+			buf.push_back(2);
+		} else {
+			buf.push_back(0);
+			put(buf, ep.ep_close.tag);
+		}
+		put(buf, ep.ep_moves.size());
+		bool counted = false;
+		for (const episode::move& mv : ep.ep_moves) {
+			counted |= mv.info.iterations || mv.info.playouts || mv.info.nodes || mv.info.depth || mv.info.result;
+		}
+		buf.push_back(counted);
+		for (const episode::move& mv : ep.ep_moves) {
+			action::place move(mv.code);
+			buf.push_back(char(move.position().i | (move.color() == board::white ? 0x80 : 0)));
+			put(buf, mv.time);
+			if (!counted) continue;
+			put(buf, mv.info.iterations);
+			put(buf, mv.info.playouts);
+			put(buf, mv.info.nodes);
+			put(buf, mv.info.depth);
+			buf.push_back(char(mv.info.result));
+		}
+		out.write(buf.data(), buf.size());
+		offset += buf.size();
+		count++;
+		return bool(out);
+	}
+
+	/**
+	 * append the index and close the file
+	 */
+	bool close() {
+		if (!out.is_open()) return true;
+		trailer t;
+		t.index = offset;
+		std::memcpy(t.magic, index_magic(), sizeof(t.magic));
+		uint64_t entries = index.size();
+		out.put(char(index_tag));
+		out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+		out.write(reinterpret_cast<const char*>(&entries), sizeof(entries));
+		out.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(uint64_t));
+		out.write(reinterpret_cast<const char*>(&t), sizeof(t));
+		bool ok = bool(out.flush());
+		out.close();
+		return ok;
+	}
+
+	size_t size() const { return count; }
+
+private:
+	std::ofstream out;
+	std::string buf;
+	std::vector<uint64_t> index;
+	uint32_t block;
+	uint64_t count;
+	uint64_t offset;
+};
+
+/**
+ * streaming reader of the binary format
+ */
+class episode_reader : public episode_archive {
+public:
+	episode_reader() : buffer(1 << 16), format(0), block(0), count(0), broken(false) {}
+
+	/**
+	 * open the file, return false if it is not in the binary format or is of another board size
+	 */
+	bool open(const std::string& path) {
+		in.close();
+		in.clear();
+		in.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+		in.open(path, std::ios::in | std::ios::binary);
+		layout h;
+		if (!in.read(reinterpret_cast<char*>(&h), sizeof(h))) return false;
+		if (!version(h) || h.size_x != board::size_x || h.size_y != board::size_y) return false;
+		format = version(h);
+		block = h.block;
+		count = 0;
+		broken = false;
+		index.clear();
+
+		// the index is optional, e.g., it is missing if the writer was interrupted
+		trailer t;
+		if (in.seekg(-int(sizeof(t)), std::ios::end) && in.read(reinterpret_cast<char*>(&t), sizeof(t))
+				&& std::memcmp(t.magic, index_magic(), sizeof(t.magic)) == 0 && in.seekg(t.index) && in.get() == index_tag) {
+			uint64_t entries = 0;
+			in.read(reinterpret_cast<char*>(&count), sizeof(count));
+			in.read(reinterpret_cast<char*>(&entries), sizeof(entries));
+			index.resize(entries);
+			in.read(reinterpret_cast<char*>(index.data()), entries * sizeof(uint64_t));
+			if (!in) count = 0, index.clear();
+		}
+		in.clear();
+		in.seekg(sizeof(h));
+		return bool(in);
+	}
+
+	/**
+	 * read the next episode, return false at the end of the episodes or at a truncated episode (see is_broken)
+	 */
+	bool read(episode& ep) {
+		if (in.peek() != episode_tag) return false;
+		in.ignore(1);
+		broken = true; // until the episode is read completely
+		ep = {};
+		uint64_t when, duration, size, winner;
+		if (!get(in, when) || !get(in, duration) || !get(in, ep.ep_open.tag)) return false;
+		ep.ep_open.when = when;
+		ep.ep_close.when = when + unzigzag(duration);
+		const std::string& names = ep.ep_open.tag;
+		switch (winner = in.get()) {
+		case 1: ep.ep_close.tag = names.substr(0, names.find(':')); break;
+		case 2: ep.ep_close.tag = names.substr(names.find(':') + 1); break;
+		case 0: if (!get(in, ep.ep_close.tag)) return false; break;
+		default: return false;
+		}
+		if (!get(in, size)) return false;
+		bool counted = format >= 2 && in.get() == 1;
+		ep.ep_moves.reserve(size);
+		for (uint64_t i = 0; i < size; i++) {
+			int code = in.get();
+			uint64_t time, iterations = 0, playouts = 0, nodes = 0, depth = 0;
+			if (code == EOF || !get(in, time)) return false;
+			if (format < 2) time *= 1000; // in milliseconds
+			search_info info = {};
+			if (counted) {
+				if (!get(in, iterations) || !get(in, playouts) || !get(in, nodes) || !get(in, depth)) return false;
+				info.iterations = iterations;
+				info.playouts = playouts;
+				info.nodes = nodes;
+				info.depth = depth;
+				info.result = int8_t(in.get());
+			}
+			ep.ep_moves.emplace_back(action::place(code & 0x7f, code & 0x80 ? board::white : board::black), 0, time, info);
+		}
+		broken = !in;
+		return !broken;
+	}
+
+	/**
+	 * whether the last read stopped at a truncated or corrupted episode, rather than the end of the episodes
+	 */
+	bool is_broken() const { return broken; }
+
+	/**
+	 * the number of episodes, which is only known if the file has the index
+	 */
+	bool has_index() const { return index.size() || count; }
+	size_t size() const { return count; }
+
+	/**
+	 * move to the n-th episode through the index, return false if there is no index or n is out of range
+	 */
+	bool seek(size_t n) {
+		if (n > count || (n < count && n / block >= index.size())) return false;
+		in.clear();
+		if (n == count) return bool(in.seekg(0, std::ios::end));
+		in.seekg(index[n / block]);
+		episode skip;
+		for (size_t i = 0; i < n % block; i++) if (!read(skip)) return false;
+		return true;
+	}
+
+private:
+	std::vector<char> buffer;
+	std::ifstream in;
+	std::vector<uint64_t> index;
+	unsigned format;
+	uint32_t block;
+	uint64_t count;
+	bool broken;
+};
+
+/**
+ * stream the episodes of a file into another file, e.g., to convert the text format into the binary format
+ * the format of the source is detected by its header, and the format of the target is decided by its extension
+ * the conversion stops at a line which is not an episode as the operator >> of statistic does, or at a truncated archive,
+ * where the episodes before are still converted and complete (if given) is set to false
+ * return the number of converted episodes, or -1 if a file cannot be opened
+ */
+inline long convert_episodes(const std::string& from, const std::string& to, bool* complete = nullptr) {
+	std::ifstream text_in;
+	episode_reader binary_in;
+	bool binary_from = episode_archive::detect(from);
+	if (binary_from ? !binary_in.open(from) : (text_in.open(from, std::ios::in), !text_in.is_open())) return -1;
+
+	std::ofstream text_out;
+	episode_writer binary_out;
+	bool binary_to = episode_archive::binary_name(to);
+	if (binary_to ? !binary_out.open(to) : (text_out.open(to, std::ios::out | std::ios::trunc), !text_out.is_open())) return -1;
+
+	long count = 0;
+	bool valid = true;
+	episode ep;
+	for (std::string line; binary_from ? binary_in.read(ep) : (std::getline(text_in, line) && line.size()); count++) {
+		if (!binary_from && !(std::stringstream(line) >> ep)) {
+			valid = false;
+			break;
+		}
+		if (binary_to) binary_out.write(ep);
+		else text_out << ep << std::endl;
+	}
+	if (binary_from && (binary_in.is_broken() || (binary_in.has_index() && size_t(count) < binary_in.size()))) valid = false;
+	if (complete) *complete = valid;
+	if (binary_to ? !binary_out.close() : !text_out.flush()) return -1;
+	return count;
+}
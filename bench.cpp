@@ -0,0 +1,397 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * bench.cpp: Microbenchmarks for the search components
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <new>
+#include <thread>
+#include "board.h"
+#include "action.h"
+#include "agent.h"
+#include "solver.h"
+#include "cache.h"
+#include "alphabeta.h"
+#include "statistic.h"
+
+/**
+ * count every heap allocation of the process
+ * the operators are never inlined, so that the compiler never pairs the malloc and free inside with the new and delete
+ */
+static std::atomic<size_t> allocations(0);
+__attribute__((noinline)) void* operator new(size_t size) {
+	allocations++;
+	void* ptr = std::malloc(size ? size : 1);
+	if (!ptr) throw std::bad_alloc();
+	return ptr;
+}
+__attribute__((noinline)) void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { operator delete(ptr); }
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete[](void* ptr) noexcept { operator delete(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { operator delete(ptr); }
+
+/**
+ * a fixed set of positions generated by seeded random games
+ */
+std::vector<board> positions(size_t count, size_t plies, unsigned seed) {
+	std::default_random_engine engine(seed);
+	std::vector<board> res;
+	while (res.size() < count) {
+		board state;
+		std::vector<int> cells(board::size_x * board::size_y);
+		for (size_t i = 0; i < cells.size(); i++) cells[i] = i;
+		for (size_t ply = 0; ply < plies; ply++) {
+			std::shuffle(cells.begin(), cells.end(), engine);
+			bool moved = false;
+			for (int i : cells) {
+				if (action::place(i, state.info().who_take_turns).apply(state) == board::legal) {
+					moved = true;
+					break;
+				}
+			}
+			if (!moved) break;
+		}
+		res.push_back(state);
+	}
+	return res;
+}
+
+/**
+ * the output of the benchmarks, and the benchmarks to run (those whose names contain the filter)
+ */
+static bool json = false;
+static std::string filter;
+static volatile size_t sink; // the results of the benchmarks are written here, so that they are never optimized out
+
+bool selected(const std::string& name) { return name.find(filter) != std::string::npos; }
+
+/**
+ * report the values of a benchmark in a machine-readable line, which is diffable across commits
+ * either "name <tab> value unit <tab> ..." or a JSON object per line, e.g., {"name":"...","ns/op":...}
+ */
+void report(const std::string& name, const std::vector<std::pair<std::string, double>>& values) {
+	if (json) {
+		std::cout << "{\"name\":\"" << name << "\"";
+		for (const auto& value : values) std::cout << ",\"" << value.first << "\":" << (std::isfinite(value.second) ? value.second : 0);
+		std::cout << "}" << std::endl;
+	} else {
+		std::cout << name;
+		for (const auto& value : values) std::cout << "\t" << value.second << " " << value.first;
+		std::cout << std::endl;
+	}
+}
+
+/**
+ * report a benchmark as ns/op, ops/sec, and allocs/op
+ */
+void report(const std::string& name, size_t ops, double nanosec, size_t allocs) {
+	report(name, { { "ns/op", nanosec / ops }, { "ops/sec", ops * 1e9 / nanosec }, { "allocs/op", allocs * 1.0 / ops } });
+}
+
+template<typename function>
+void measure(const std::string& name, size_t ops, function run) {
+	if (!selected(name)) return;
+	size_t allocs = allocations;
+	auto start = std::chrono::steady_clock::now();
+	run();
+	auto stop = std::chrono::steady_clock::now();
+	allocs = allocations - allocs;
+	report(name, ops, std::chrono::duration<double, std::nano>(stop - start).count(), allocs);
+}
+
+int main(int argc, const char* argv[]) {
+	size_t iterations = 20000;
+	for (int i = 1; i < argc; i++) {
+		std::string para(argv[i]);
+		if (para.find("--iterations=") == 0) {
+			iterations = std::stoull(para.substr(para.find("=") + 1));
+		} else if (para.find("--filter=") == 0) {
+			filter = para.substr(para.find("=") + 1);
+		} else if (para.find("--json") == 0) {
+			json = true;
+		}
+	}
+
+	std::vector<board> set = positions(8, 10, 0);
+	size_t rounds = std::max<size_t>(iterations / 10, 1);
+
+	// the primitives of the board, over every point of the positions
+	measure("board_place", rounds * set.size() * board::size_x * board::size_y, [&]() {
+		size_t legal = 0;
+		for (size_t r = 0; r < rounds; r++) {
+			for (const board& state : set) {
+				unsigned who = state.info().who_take_turns;
+				for (int x = 0; x < board::size_x; x++) {
+					for (int y = 0; y < board::size_y; y++) {
+						board after = state;
+						legal += after.place(x, y, who) == board::legal;
+					}
+				}
+			}
+		}
+		sink = legal;
+	});
+
+	measure("board_check_liberty", rounds * set.size() * board::size_x * board::size_y, [&]() {
+		size_t liberty = 0;
+		for (size_t r = 0; r < rounds; r++) {
+			for (const board& state : set) {
+				for (int x = 0; x < board::size_x; x++) {
+					for (int y = 0; y < board::size_y; y++) liberty += state.check_liberty(x, y, state[x][y]);
+				}
+			}
+		}
+		sink = liberty;
+	});
+
+	measure("board_has_legal_move", rounds * set.size(), [&]() {
+		size_t moves = 0;
+		for (size_t r = 0; r < rounds; r++) {
+			for (const board& state : set) moves += state.has_legal_move(state.info().who_take_turns);
+		}
+		sink = moves;
+	});
+
+	// the legal moves of a position, listed in the way of the expansion of the tree
+	measure("legal_moves", rounds * set.size(), [&]() {
+		size_t moves = 0;
+		for (size_t r = 0; r < rounds; r++) {
+			for (const board& state : set) {
+				unsigned who = state.info().who_take_turns;
+				for (int i = 0; i < board::size_x * board::size_y; i++) {
+					board after = state;
+					moves += action::place(i, who).apply(after) == board::legal;
+				}
+			}
+		}
+		sink = moves;
+	});
+
+	measure("action_apply", rounds * set.size() * board::size_x * board::size_y, [&]() {
+		size_t legal = 0;
+		for (size_t r = 0; r < rounds; r++) {
+			for (const board& state : set) {
+				unsigned who = state.info().who_take_turns;
+				for (int i = 0; i < board::size_x * board::size_y; i++) {
+					board after = state;
+					action move = action::place(i, who);
+					legal += move.apply(after) == board::legal;
+				}
+			}
+		}
+		sink = legal;
+	});
+
+	// a single playout from the positions, by the playout policy of the MCTS
+	mcts_agent<> black("role=black seed=0"), white("role=white seed=0");
+	measure("playout", iterations * set.size(), [&]() {
+		size_t wins = 0;
+		for (const board& state : set) {
+			board::piece_type who = static_cast<board::piece_type>(state.info().who_take_turns);
+			mcts_agent<>& agent = (who == board::black) ? black : white;
+			agent.init_tree(state, who);
+			for (size_t i = 0; i < iterations; i++) wins += agent.simulation(state, who);
+		}
+		sink = wins;
+	});
+
+	mtcs_uct_player player("name=bench role=black seed=0");
+	measure("mcts_iteration", iterations * set.size(), [&]() {
+		for (const board& state : set) {
+			player.init_tree(state, state.info().who_take_turns);
+			for (size_t i = 0; i < iterations; i++) player.update();
+		}
+	});
+
+	mtcs_uct_player widening("name=bench role=black seed=0 pw_c=2");
+	measure("mcts_iteration_widening", iterations * set.size(), [&]() {
+		for (const board& state : set) {
+			widening.init_tree(state, state.info().who_take_turns);
+			for (size_t i = 0; i < iterations; i++) widening.update();
+		}
+	});
+
+	alphabeta_search alphabeta(1 << 20, 200);
+	size_t alphabeta_nodes = 0;
+	double alphabeta_time = 0;
+	int alphabeta_depth = 0;
+	measure("alphabeta_search", set.size(), [&]() {
+		for (const board& state : set) {
+			alphabeta.clear();
+			alphabeta.search(state);
+			alphabeta_nodes += alphabeta.node_count();
+			alphabeta_time += alphabeta.seconds();
+			alphabeta_depth += alphabeta.depth();
+		}
+	});
+	if (selected("alphabeta_search"))
+		report("alphabeta_stats", { { "nodes", alphabeta_nodes }, { "nodes/sec", alphabeta_nodes / alphabeta_time },
+			{ "depth", alphabeta_depth * 1.0 / set.size() } });
+
+	std::vector<board> endgames = positions(6, 56, 7);
+
+	pn_solver pns;
+	measure("pns_solve", endgames.size(), [&]() {
+		for (const board& state : endgames) pns.solve(state);
+	});
+
+	dfpn_solver dfpn;
+	size_t dfpn_nodes = 0;
+	double dfpn_rate = 0, dfpn_time = 0;
+	measure("dfpn_solve", endgames.size(), [&]() {
+		for (const board& state : endgames) {
+			dfpn.solve(state);
+			dfpn_nodes += dfpn.node_count();
+			dfpn_rate += dfpn.hit_rate();
+			dfpn_time += dfpn.seconds();
+		}
+	});
+	if (selected("dfpn_solve"))
+		report("dfpn_stats", { { "nodes", dfpn_nodes }, { "nodes/sec", dfpn_nodes / dfpn_time },
+			{ "%tt_hit", dfpn_rate * 100 / endgames.size() }, { "MB", dfpn.memory() >> 20 } });
+
+	// the proofs reused by the next move, i.e., after a proven move and a reply of the opponent
+	std::vector<board> replies;
+	pn_solver pns_reuse;
+	dfpn_solver dfpn_reuse;
+	for (const board& state : endgames) {
+		if (!selected("pns_solve_reuse") && !selected("dfpn_solve_reuse") && !selected("cache_probe")) break;
+		pns_reuse.solve(state);
+		dfpn_reuse.solve(state);
+		board next = state;
+		if (pns_reuse.proven_move() == -1) continue;
+		if (action::place(pns_reuse.proven_move(), next.info().who_take_turns).apply(next) != board::legal) continue;
+		for (int i = 0; i < board::size_x * board::size_y; i++) {
+			if (action::place(i, next.info().who_take_turns).apply(next) == board::legal) {
+				replies.push_back(next);
+				break;
+			}
+		}
+	}
+	if (replies.size()) {
+		measure("pns_solve_reuse", replies.size(), [&]() {
+			for (const board& state : replies) pns_reuse.solve(state);
+		});
+		measure("dfpn_solve_reuse", replies.size(), [&]() {
+			for (const board& state : replies) dfpn_reuse.solve(state);
+		});
+	}
+
+	// the persistent cache of solved positions, probed by the canonical hash
+	const char* path = "bench.cache";
+	std::remove(path);
+	solved_cache cache;
+	if (selected("cache_probe") && cache.open(path, 1 << 16)) {
+		for (const board& state : endgames) {
+			int result = pns_reuse.solve(state);
+			cache.store(state.canonical_hash(), result, pns_reuse.proven_move());
+		}
+		size_t probes = iterations * endgames.size();
+		measure("cache_probe", probes, [&]() {
+			size_t found = 0;
+			for (size_t i = 0; i < iterations; i++) {
+				for (const board& state : endgames) found += cache.probe(state.canonical_hash()) != solved_cache::unknown;
+			}
+			sink = found;
+		});
+		cache.close();
+	}
+	std::remove(path);
+
+	// the speedup curve of the parallel df-pn
+	std::vector<board> hard = positions(2, 52, 11);
+	size_t cores = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	for (size_t threads = 1; threads <= std::max<size_t>(cores, 4); threads *= 2) {
+		dfpn_solver parallel(1 << 22, 60000);
+		parallel.set_threads(threads);
+		measure("dfpn_solve_threads=" + std::to_string(threads), hard.size(), [&]() {
+			for (const board& state : hard) parallel.solve(state);
+		});
+	}
+
+	// a full decision of every player, from the positions of either side
+	const std::vector<std::pair<std::string, std::string>> players = {
+		{ "random", "" }, { "uct", "" }, { "rave", "" }, { "rave-pn", "" }, { "sample", "" },
+		{ "black", "" }, { "white", "" }, { "alpha-beta", "depth=4" }, { "mcts", "iterations=1000 solver=pns" },
+	};
+	for (const auto& player : players) {
+		std::string name = "take_action_" + player.first;
+		if (!selected(name)) continue;
+		std::string args = "search=" + player.first + " seed=0 " + player.second;
+		std::unique_ptr<agent> black = make_player("name=black role=black " + args);
+		std::unique_ptr<agent> white = make_player("name=white role=white " + args);
+		measure(name, set.size(), [&]() {
+			size_t moves = 0;
+			for (const board& state : set) {
+				agent& who = (state.info().who_take_turns == board::black) ? *black : *white;
+				who.open_episode();
+				moves += who.take_action(state).type() == action::place::type;
+				who.close_episode();
+			}
+			sink = moves;
+		});
+	}
+
+	// the loaders of a saved statistic in the text format, by the stream parser and by the parallel loader,
+	// and the conversion into the binary format
+	const char* log = "bench.log";
+	std::vector<episode> games(2000);
+	if (selected("statistic_load_stream") || selected("statistic_load_mmap") || selected("archive_convert") || selected("malformed_log")) {
+		random_player black("name=black role=black seed=1"), white("name=white role=white seed=2");
+		for (episode& game : games) {
+			game.open_episode("black:white");
+			while (game.apply_action(game.take_turns(black, white).take_action(game.state())));
+			game.close_episode(game.last_turns(black, white).name());
+		}
+		std::ofstream out(log, std::ios::out | std::ios::trunc);
+		for (int copy = 0; copy < 10; copy++) for (const episode& game : games) out << game << std::endl;
+	}
+	statistic streamed(0), mapped(0);
+	measure("statistic_load_stream", 20000, [&]() {
+		std::ifstream in(log, std::ios::in);
+		in >> streamed;
+	});
+	measure("statistic_load_mmap", 20000, [&]() {
+		mapped.load_text(log);
+	});
+	measure("archive_convert", 20000, [&]() {
+		convert_episodes(log, "bench.bin");
+	});
+	std::remove("bench.bin");
+	std::remove(log);
+
+	// a line which is not an episode in the middle of a log ends every reader there, and is reported
+	if (selected("malformed_log")) {
+		std::ofstream(log, std::ios::out | std::ios::trunc) << games[0] << std::endl << games[1] << std::endl
+			<< "garbage line here" << std::endl << games[2] << std::endl << games[3] << std::endl;
+		statistic streamed(0), mapped(0);
+		std::ifstream in(log, std::ios::in);
+		in >> streamed;
+		bool loaded = mapped.load(log), converted = true;
+		long count = convert_episodes(log, "bench.bin", &converted);
+		statistic reloaded(0);
+		reloaded.load("bench.bin");
+		std::remove("bench.bin");
+		std::remove(log);
+		report("malformed_log", { { "stream", streamed.size() }, { "load", mapped.size() }, { "convert", count } });
+		if (streamed.size() != 2 || mapped.size() != 2 || count != 2 || reloaded.size() != 2 || loaded || converted) {
+			std::cerr << "malformed_log: the readers do not stop at the malformed line" << std::endl;
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -15,6 +15,8 @@
 #include <algorithm>
 #include <utility>
 #include <cmath>
+#include <cstdint>
+#include <random>
 
 /**
  * definition for the 9x9 board
@@ -136,6 +138,33 @@ public:
 		return place(p.x, p.y, who);
 	}
 
+	/**
+	 * whether a side has any legal move, by an early-exit scan
+	 * an empty point with an empty neighbor and no neighboring opponent stone is always legal,
+	 * so that placing a stone is only tried at the other empty points
+	 */
+	bool has_legal_move(unsigned who) const {
+		unsigned opp = 3u - who;
+		for (int x = 0; x < size_x; x++) {
+			for (int y = 0; y < size_y; y++) {
+				if (stone[x][y] != piece_type::empty) continue;
+				cell near[4] = {
+					x > 0 ? stone[x - 1][y] : -1u, x < size_x - 1 ? stone[x + 1][y] : -1u,
+					y > 0 ? stone[x][y - 1] : -1u, y < size_y - 1 ? stone[x][y + 1] : -1u };
+				bool liberty = false, contact = false;
+				for (cell c : near) {
+					if (c == piece_type::empty) liberty = true;
+					else if (c == opp) contact = true;
+				}
+				if (liberty && !contact) return true;
+				board test = *this;
+				test.attr.who_take_turns = static_cast<piece_type>(who);
+				if (test.place(x, y, who) == nogo_move_result::legal) return true;
+			}
+		}
+		return false;
+	}
+
 	/**
 	 * calculate the liberty of the block of piece at [x][y]
 	 * return >= 0 if [x][y] is placed by who; otherwise return -1
@@ -145,32 +174,79 @@ public:
 		if (test[x][y] != who) return -1;
 
 		int liberty = 0;
-		std::list<point> check;
-		for (check.emplace_back(x, y); check.size(); check.pop_front()) {
-			int x = check.front().x, y = check.front().y;
-			test[x][y] = piece_type::unknown; // prevent recalculate
+		struct { int x, y; } check[size_x * size_y]; // each cell is queued at most once
+		size_t head = 0, tail = 0;
+		test[x][y] = piece_type::unknown; // prevent recalculate
+		for (check[tail++] = {x, y}; head < tail; head++) {
+			int x = check[head].x, y = check[head].y;
 
 			point p_min(0, 0), p_max(size_x - 1, size_y - 1);
 
 			cell near_l = x > p_min.x ? test[x - 1][y] : -1u; // left
 			if (near_l == piece_type::empty) liberty++;
-			else if (near_l == who) check.emplace_back(x - 1, y);
+			else if (near_l == who) test[x - 1][y] = piece_type::unknown, check[tail++] = {x - 1, y};
 
 			cell near_r = x < p_max.x ? test[x + 1][y] : -1u; // right
 			if (near_r == piece_type::empty) liberty++;
-			else if (near_r == who) check.emplace_back(x + 1, y);
+			else if (near_r == who) test[x + 1][y] = piece_type::unknown, check[tail++] = {x + 1, y};
 
 			cell near_d = y > p_min.y ? test[x][y - 1] : -1u; // down
 			if (near_d == piece_type::empty) liberty++;
-			else if (near_d == who) check.emplace_back(x, y - 1);
+			else if (near_d == who) test[x][y - 1] = piece_type::unknown, check[tail++] = {x, y - 1};
 
 			cell near_u = y < p_max.y ? test[x][y + 1] : -1u; // up
 			if (near_u == piece_type::empty) liberty++;
-			else if (near_u == who) check.emplace_back(x, y + 1);
+			else if (near_u == who) test[x][y + 1] = piece_type::unknown, check[tail++] = {x, y + 1};
 		}
 		return liberty;
 	}
 
+	/**
+	 * the zobrist hash of the stones and the side to move
+	 */
+	uint64_t hash() const {
+		uint64_t h = attr.who_take_turns == piece_type::white ? zobrist_turn() : 0;
+		for (int x = 0; x < size_x; x++) {
+			for (int y = 0; y < size_y; y++) {
+				cell c = stone[x][y];
+				if (c == piece_type::black || c == piece_type::white) h ^= zobrist(point(x, y).i, c);
+			}
+		}
+		return h;
+	}
+
+	/**
+	 * the zobrist keys, for updating a hash incrementally
+	 * placing a stone of who at i then switching the turn is: h ^ zobrist(i, who) ^ zobrist_turn()
+	 */
+	static uint64_t zobrist(unsigned i, unsigned who) { return zobrist_keys()[(who - 1) * size_x * size_y + i]; }
+	static uint64_t zobrist_turn() { return zobrist_keys()[2 * size_x * size_y]; }
+
+	/**
+	 * the hash shared by all the symmetric positions, which is the smallest hash among the 8 symmetries
+	 * the symmetry leading to it is given if requested, see symmetric
+	 */
+	uint64_t canonical_hash(unsigned* symmetry = nullptr) const {
+		uint64_t h[8];
+		std::fill(h, h + 8, attr.who_take_turns == piece_type::white ? zobrist_turn() : 0);
+		for (int i = 0; i < size_x * size_y; i++) {
+			cell c = (*this)(i);
+			if (c != piece_type::black && c != piece_type::white) continue;
+			for (unsigned s = 0; s < 8; s++) h[s] ^= zobrist(symmetric(i, s), c);
+		}
+		unsigned best = std::min_element(h, h + 8) - h;
+		if (symmetry) *symmetry = best;
+		return h[best];
+	}
+
+	/**
+	 * the 1-d position of i under the symmetry s of the board, where s is in [0, 8), i.e.,
+	 * s & 1 reflects horizontally, s & 2 reflects vertically, and then s & 4 transposes
+	 * asymmetric is the inverse, which maps a position under the symmetry s back
+	 */
+	static int symmetric(unsigned i, unsigned s) { return symmetries().forward[s][i]; }
+	static int asymmetric(unsigned i, unsigned s) { return symmetries().backward[s][i]; }
+
 	void transpose() {
 		for (int x = 0; x < size_x; x++) {
 			for (int y = x + 1; y < size_y; y++) {
@@ -274,6 +350,34 @@ public:
 
 protected:
 	static const grid& initial() { static grid stone; return stone; }
+	static const std::array<uint64_t, 2 * size_x * size_y + 1>& zobrist_keys() {
+		struct table : std::array<uint64_t, 2 * size_x * size_y + 1> {
+			table() {
+				std::mt19937_64 engine(0x9e3779b97f4a7c15ull); // fixed keys, so that hashes can be saved into files
+				for (uint64_t& key : *this) key = engine();
+			}
+		};
+		static const table keys;
+		return keys;
+	}
+	static_assert(size_x == size_y, "the symmetries are defined on a square board");
+	struct symmetry_table {
+		uint8_t forward[8][size_x * size_y];
+		uint8_t backward[8][size_x * size_y];
+		symmetry_table() {
+			for (unsigned s = 0; s < 8; s++) {
+				for (int x = 0; x < size_x; x++) {
+					for (int y = 0; y < size_y; y++) {
+						int u = s & 1 ? size_x - 1 - x : x, v = s & 2 ? size_y - 1 - y : y;
+						point p(s & 4 ? v : u, s & 4 ? u : v);
+						forward[s][point(x, y).i] = p.i;
+						backward[s][p.i] = point(x, y).i;
+					}
+				}
+			}
+		}
+	};
+	static const symmetry_table& symmetries() { static const symmetry_table table; return table; }
 	static __attribute__((constructor)) void init_initial_scheme() {
 		grid& stone = const_cast<grid&>(initial());
 		point hollow((size_x - hollow_x) / 2, (size_y - hollow_y) / 2);
@@ -0,0 +1,113 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * book.cpp: Offline builder of the opening book
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#include <iostream>
+#include <string>
+#include <iterator>
+#include <algorithm>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <unordered_set>
+#include "board.h"
+#include "action.h"
+#include "agent.h"
+#include "book.h"
+
+int main(int argc, const char* argv[]) {
+	std::cout << "NoGo-Book: ";
+	std::copy(argv, argv + argc, std::ostream_iterator<const char*>(std::cout, " "));
+	std::cout << std::endl << std::endl;
+
+	std::string output = "book.bin";
+	size_t plies = 6, width = 3;
+	int iterations = 20000;
+	size_t threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	std::string args;
+	for (int i = 1; i < argc; i++) {
+		std::string para(argv[i]);
+		if (para.find("--output=") == 0) {
+			output = para.substr(para.find("=") + 1);
+		} else if (para.find("--plies=") == 0) {
+			plies = std::stoull(para.substr(para.find("=") + 1));
+		} else if (para.find("--width=") == 0) {
+			width = std::max<size_t>(std::stoull(para.substr(para.find("=") + 1)), 1);
+		} else if (para.find("--iterations=") == 0) {
+			iterations = std::stoi(para.substr(para.find("=") + 1));
+		} else if (para.find("--threads=") == 0) {
+			threads = std::max<size_t>(std::stoull(para.substr(para.find("=") + 1)), 1);
+		} else if (para.find("--args=") == 0) {
+			args = para.substr(para.find("=") + 1);
+		}
+	}
+
+	// the book is built ply by ply, every position of a ply is searched deeply by MCTS,
+	// the statistics of its moves are recorded, and its most played moves lead to the positions of the next ply
+	// the positions of a ply are shared by the threads through a counter
+	auto start = std::chrono::steady_clock::now();
+	std::vector<opening_book::record> records;
+	std::vector<board> frontier(1);
+	std::unordered_set<uint64_t> seen = { board().canonical_hash() };
+	std::mutex merge;
+	for (size_t ply = 0; ply < plies && frontier.size(); ply++) {
+		std::vector<board> next;
+		std::atomic<size_t> index(0);
+		auto work = [&](size_t id) {
+			std::string seed = " seed=" + std::to_string(ply * threads + id);
+			mcts_agent<> black("role=black " + args + seed), white("role=white " + args + seed);
+			std::vector<opening_book::record> found;
+			std::vector<board> children;
+			for (size_t k; (k = index++) < frontier.size(); ) {
+				const board& state = frontier[k];
+				board::piece_type who = static_cast<board::piece_type>(state.info().who_take_turns);
+				mcts_agent<>& agent = (who == board::black) ? black : white;
+				agent.clear_statistics();
+				agent.init_tree(state, who);
+				agent.search(iterations);
+
+				unsigned symmetry;
+				uint64_t key = state.canonical_hash(&symmetry);
+				std::vector<std::pair<int, int>> ranks; // (games, move)
+				for (int i = 0; i < board::size_x * board::size_y; i++) {
+					std::pair<int, int> s = agent.root_stat(i);
+					if (s.second == 0) continue;
+					found.push_back(opening_book::pack(key, board::symmetric(i, symmetry), s.second, s.first));
+					ranks.emplace_back(s.second, i);
+				}
+				std::sort(ranks.rbegin(), ranks.rend());
+				for (size_t r = 0; r < std::min(width, ranks.size()); r++) {
+					board after = state;
+					action::place(ranks[r].second, who).apply(after);
+					children.push_back(after);
+				}
+			}
+			std::lock_guard<std::mutex> lock(merge);
+			records.insert(records.end(), found.begin(), found.end());
+			for (const board& child : children) {
+				if (seen.insert(child.canonical_hash()).second) next.push_back(child);
+			}
+		};
+		std::vector<std::thread> workers;
+		for (size_t i = 0; i < threads; i++) workers.emplace_back(work, i);
+		for (std::thread& worker : workers) worker.join();
+		std::cerr << "ply " << ply << ": " << frontier.size() << " positions" << std::endl;
+		frontier.swap(next);
+	}
+
+	if (!opening_book::write(output, records)) {
+		std::cerr << "cannot write " << output << std::endl;
+		return 1;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << records.size() << " moves of " << seen.size() - frontier.size() << " positions, "
+	          << "written to " << output << " in " << seconds << " seconds" << std::endl;
+	return 0;
+}
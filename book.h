@@ -0,0 +1,160 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * book.h: Opening book keyed by the canonical hash
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "board.h"
+#include "action.h"
+
+/**
+ * a read-only opening book, built offline (see book.cpp) and keyed by the canonical hash
+ *
+ * the file is a header followed by the records sorted by the keys, and a record holds the statistics of a move,
+ * i.e., the games and the wins (for the side to move) of the move in the coordinates of the canonical symmetry
+ * the key and the move are packed as the upper 56 bits and the lowest byte of a word, so that the records
+ * of a position are adjacent and sorted by their moves
+ * the file is memory-mapped, and a probe is a binary search without allocation
+ */
+class opening_book {
+public:
+	struct record {
+		uint64_t key; // the canonical hash with the move in the lowest byte
+		uint32_t games;
+		uint32_t wins;
+		bool operator <(const record& r) const { return key < r.key; }
+	};
+
+public:
+	opening_book() : header(nullptr), records(nullptr), length(0) {}
+	~opening_book() { close(); }
+	opening_book(const opening_book&) = delete;
+	opening_book& operator =(const opening_book&) = delete;
+
+	/**
+	 * map the book file, return false if it cannot be opened or is not a book
+	 */
+	bool open(const std::string& path) {
+		close();
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) return false;
+		struct stat st;
+		void* mapped = MAP_FAILED;
+		if (::fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(layout)) {
+			length = st.st_size;
+			mapped = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+		}
+		::close(fd);
+		if (mapped == MAP_FAILED) return length = 0, false;
+
+		const layout* h = static_cast<const layout*>(mapped);
+		if (std::memcmp(h->magic, magic(), sizeof(h->magic)) != 0 || length != sizeof(layout) + h->count * sizeof(record)) {
+			::munmap(mapped, length);
+			return length = 0, false;
+		}
+		header = h;
+		records = reinterpret_cast<const record*>(h + 1);
+		return true;
+	}
+
+	void close() {
+		if (header) ::munmap(const_cast<layout*>(header), length);
+		header = nullptr;
+		records = nullptr;
+		length = 0;
+	}
+
+	bool is_open() const { return header; }
+	size_t size() const { return header ? header->count : 0; }
+
+	/**
+	 * the records of a position, as the range [first, last)
+	 */
+	void find(uint64_t key, const record*& first, const record*& last) const {
+		first = last = records;
+		if (!header) return;
+		record lower = { key & ~uint64_t(0xff), 0, 0 };
+		first = std::lower_bound(records, records + header->count, lower);
+		for (last = first; last != records + header->count && ((last->key ^ key) >> 8) == 0; last++);
+	}
+
+	/**
+	 * the most played book move of a position with at least the given games, or -1 if none
+	 */
+	int probe(const board& state, uint32_t min_games = 1) const {
+		if (!header) return -1;
+		unsigned symmetry;
+		uint64_t key = state.canonical_hash(&symmetry);
+		const record *first, *last;
+		find(key, first, last);
+		const record* best = nullptr;
+		for (const record* r = first; r != last; r++) {
+			if (r->games >= min_games && (!best || r->games > best->games)) best = r;
+		}
+		if (!best) return -1;
+		int move = board::asymmetric(best->key & 0xff, symmetry);
+		board after = state;
+		return action::place(move, state.info().who_take_turns).apply(after) == board::legal ? move : -1;
+	}
+
+	/**
+	 * pack the statistics of a move into a record, where the move is in the coordinates of the canonical symmetry
+	 */
+	static record pack(uint64_t key, int move, uint32_t games, uint32_t wins) {
+		return { (key & ~uint64_t(0xff)) | uint64_t(move), games, wins };
+	}
+
+	/**
+	 * write the records into a book file, the records of the same move are merged
+	 * return false if the file cannot be written
+	 */
+	static bool write(const std::string& path, std::vector<record>& list) {
+		std::sort(list.begin(), list.end());
+		size_t count = 0;
+		for (size_t i = 0; i < list.size(); i++) {
+			if (count && list[count - 1].key == list[i].key) {
+				list[count - 1].games += list[i].games;
+				list[count - 1].wins += list[i].wins;
+			} else {
+				list[count++] = list[i];
+			}
+		}
+		list.resize(count);
+
+		layout h;
+		std::memcpy(h.magic, magic(), sizeof(h.magic));
+		h.count = list.size();
+		std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!out.is_open()) return false;
+		out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+		out.write(reinterpret_cast<const char*>(list.data()), list.size() * sizeof(record));
+		return bool(out.flush());
+	}
+
+private:
+	struct layout {
+		char magic[8];
+		uint64_t count; // the number of records
+	};
+
+	static const char* magic() { return "NOGOBK01"; }
+
+private:
+	const layout* header;
+	const record* records;
+	size_t length;
+};
@@ -0,0 +1,142 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * cache.h: Persistent cache of solved positions shared by processes
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "board.h"
+
+/**
+ * a cache of solved positions in a memory-mapped file, keyed by the canonical hash (see board::canonical_hash)
+ *
+ * the file is a header followed by an open-addressing table of 64-bit slots, and a slot packs
+ * the upper 56 bits of the key, the result, and the winning move (in the coordinates of the canonical symmetry)
+ * since a slot is read and written as a whole by atomic operations, processes may share the file without locks
+ * positions are only appended into empty slots and never overwritten, a position is dropped if its bucket is full
+ *
+ * opening the file maps it without reading, and a probe touches a single bucket, so neither of them allocates
+ */
+class solved_cache {
+public:
+	enum result_type { unknown = 0, win = 1, loss = -1 };
+
+public:
+	solved_cache() : slots(nullptr), capacity(0), length(0) {}
+	~solved_cache() { close(); }
+	solved_cache(const solved_cache&) = delete;
+	solved_cache& operator =(const solved_cache&) = delete;
+
+	/**
+	 * open the cache file, which is created with the given number of slots if it does not exist
+	 * an existing file keeps its own number of slots
+	 * return false if the file cannot be opened or is not a cache, the cache is then disabled
+	 */
+	bool open(const std::string& path, size_t size = 1 << 22) {
+		close();
+		int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+		if (fd < 0) return false;
+		::flock(fd, LOCK_EX); // the creation of the file is the only critical section
+		struct stat st;
+		bool fresh = ::fstat(fd, &st) == 0 && st.st_size == 0;
+		if (fresh) {
+			size = std::max<size_t>(size_t(1) << log2(size), bucket);
+			length = sizeof(header) + size * sizeof(uint64_t);
+			if (::ftruncate(fd, length) != 0) length = 0;
+		} else {
+			length = st.st_size;
+		}
+		void* mapped = length ? ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+		if (mapped != MAP_FAILED) {
+			header* h = static_cast<header*>(mapped);
+			if (fresh) {
+				std::memcpy(h->magic, magic(), sizeof(h->magic));
+				h->slots = size;
+			}
+			if (std::memcmp(h->magic, magic(), sizeof(h->magic)) == 0 && (h->slots & (h->slots - 1)) == 0
+					&& length == sizeof(header) + h->slots * sizeof(uint64_t)) {
+				slots = reinterpret_cast<std::atomic<uint64_t>*>(h + 1);
+				capacity = h->slots;
+			} else {
+				::munmap(mapped, length);
+			}
+		}
+		::flock(fd, LOCK_UN);
+		::close(fd); // the mapping stays valid after closing the file
+		if (!slots) length = 0;
+		return slots;
+	}
+
+	void close() {
+		if (slots) ::munmap(reinterpret_cast<header*>(slots) - 1, length);
+		slots = nullptr;
+		capacity = length = 0;
+	}
+
+	bool is_open() const { return slots; }
+	size_t size() const { return capacity; }
+
+	/**
+	 * the result of a position for its side to move, and its winning move if any (-1 if none)
+	 */
+	int probe(uint64_t key, int* move = nullptr) const {
+		if (!slots) return unknown;
+		std::atomic<uint64_t>* b = bucket_of(key);
+		for (size_t i = 0; i < bucket; i++) {
+			uint64_t slot = b[i].load(std::memory_order_acquire);
+			if (slot == 0) break; // slots are filled in order
+			if ((slot ^ key) >> 8) continue;
+			if (move) *move = (slot & 0x7f) != 0x7f ? int(slot & 0x7f) : -1;
+			return slot & 0x80 ? win : loss;
+		}
+		return unknown;
+	}
+
+	/**
+	 * record a solved position, return false if it cannot be recorded since its bucket is full
+	 */
+	bool store(uint64_t key, int result, int move = -1) {
+		if (!slots || result == unknown) return false;
+		uint64_t slot = (key & ~uint64_t(0xff)) | (result == win ? 0x80 : 0) | (move >= 0 ? move : 0x7f);
+		std::atomic<uint64_t>* b = bucket_of(key);
+		for (size_t i = 0; i < bucket; i++) {
+			uint64_t expected = 0;
+			if (b[i].compare_exchange_strong(expected, slot, std::memory_order_release)) return true;
+			if (((expected ^ key) >> 8) == 0) return true; // recorded already, by this or another process
+		}
+		return false;
+	}
+
+private:
+	enum { bucket = 8 };
+	struct header {
+		char magic[8];
+		uint64_t slots;
+	};
+	static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "a slot should be a plain 64-bit word");
+
+	static const char* magic() { return "NOGOSLV1"; }
+	static unsigned log2(size_t size) {
+		unsigned n = 0;
+		while ((size_t(2) << n) <= size) n++;
+		return n;
+	}
+	std::atomic<uint64_t>* bucket_of(uint64_t key) const { return &slots[(key >> 8) & (capacity - bucket)]; }
+
+private:
+	std::atomic<uint64_t>* slots;
+	size_t capacity;
+	size_t length;
+};
@@ -0,0 +1,56 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * cancel.h: Cancellation token and deadline of the searches
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+
+/**
+ * the cancellation token of a search, which is cancelled by another thread or expires at its deadline
+ *
+ * a search polls the token with its step counter, where the flag is a relaxed load and the clock is only read
+ * once every 256 steps, so that polling at every step is cheap and a stop takes effect within 256 steps
+ * a cancellation holds until it is cleared by cancel(false), and the deadline is set by the search before it starts
+ * a stopped search keeps its state (e.g., the tree or the table), so that it is resumed by searching again
+ */
+class cancel_token {
+public:
+	typedef std::chrono::steady_clock clock;
+
+public:
+	cancel_token() : cancelled(false), deadline(clock::time_point::max()) {}
+
+	/**
+	 * request the search to stop, which may be called from another thread
+	 */
+	void cancel(bool flag = true) { cancelled.store(flag, std::memory_order_relaxed); }
+	bool is_cancelled() const { return cancelled.load(std::memory_order_relaxed); }
+
+	/**
+	 * set the deadline of the search, or clear it by a non-positive time
+	 */
+	void expire_at(clock::time_point when) { deadline = when; }
+	void expire_after(time_t millisec) {
+		deadline = millisec > 0 ? clock::now() + std::chrono::milliseconds(millisec) : clock::time_point::max();
+	}
+	bool is_expired() const { return deadline != clock::time_point::max() && clock::now() >= deadline; }
+
+	/**
+	 * whether the search should stop at its count-th step
+	 */
+	bool poll(uint64_t count) const {
+		return is_cancelled() || ((count & 0xff) == 0 && deadline != clock::time_point::max() && clock::now() >= deadline);
+	}
+
+private:
+	std::atomic<bool> cancelled;
+	clock::time_point deadline;
+};
@@ -0,0 +1,173 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * endgame.cpp: Offline generator of the endgame database
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#include <iostream>
+#include <string>
+#include <iterator>
+#include <algorithm>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include "board.h"
+#include "action.h"
+#include "endgame.h"
+#include "solver.h"
+
+/**
+ * exhaustive solver of the endgames reached by a worker thread
+ *
+ * the positions are solved by negamax over all their legal moves, so that every reached position
+ * with at most the given number of legal moves is solved and recorded, not only the ones on a proof
+ * positions with more legal moves (e.g., the replies of the opponent) are solved with cutoffs and are not recorded
+ * the results are memoized by the canonical hash in a fixed-size table, so that transpositions and symmetries
+ * are usually solved once, where an overwritten position is solved and recorded again
+ * the records are sorted and deduplicated whenever they double, so that they grow with the unique positions
+ */
+class endgame_generator {
+public:
+	endgame_generator(unsigned moves, size_t entries = 1 << 20) : moves(moves), memo(entries), threshold(1 << 20) {}
+
+	/**
+	 * solve a position for its side to move, return true if it wins
+	 */
+	bool solve(const board& state) {
+		unsigned symmetry;
+		uint64_t key = state.canonical_hash(&symmetry);
+		int known = memo.probe(key);
+		if (known != solved_table::unknown) return known == solved_table::win;
+
+		unsigned who = state.info().who_take_turns;
+		int legal[board::size_x * board::size_y];
+		unsigned count = 0;
+		for (int i = 0; i < board::size_x * board::size_y; i++) {
+			board after = state;
+			if (action::place(i, who).apply(after) == board::legal) legal[count++] = i;
+		}
+
+		bool exhaustive = count <= moves;
+		int winning = -1;
+		for (unsigned k = 0; k < count && (exhaustive || winning == -1); k++) {
+			board after = state;
+			board::point p(legal[k]);
+			after[p.x][p.y] = who;
+			after.info({static_cast<board::piece_type>(3u - who)});
+			if (!solve(after) && winning == -1) winning = legal[k];
+		}
+		memo.store(key, winning != -1 ? solved_table::win : solved_table::loss);
+		if (exhaustive && count > 0) {
+			int move = winning != -1 ? board::symmetric(winning, symmetry) : -1;
+			records.push_back(endgame_db::record(key, winning != -1 ? endgame_db::win : endgame_db::loss, move));
+			if (records.size() >= threshold) compact();
+		}
+		return winning != -1;
+	}
+
+	std::vector<uint64_t>& results() { return records; }
+
+private:
+	/**
+	 * remove the duplicated records, i.e., of the same key, as endgame_db::write does
+	 */
+	void compact() {
+		std::sort(records.begin(), records.end());
+		records.erase(std::unique(records.begin(), records.end(),
+			[](uint64_t a, uint64_t b) { return (a >> 8) == (b >> 8); }), records.end());
+		threshold = std::max(threshold, records.size() * 2);
+	}
+
+private:
+	unsigned moves;
+	solved_table memo;
+	std::vector<uint64_t> records;
+	size_t threshold;
+};
+
+/**
+ * the number of legal moves of the side to move
+ */
+unsigned mobility(const board& state) {
+	unsigned count = 0;
+	for (int i = 0; i < board::size_x * board::size_y; i++) {
+		board after = state;
+		if (action::place(i, state.info().who_take_turns).apply(after) == board::legal) count++;
+	}
+	return count;
+}
+
+int main(int argc, const char* argv[]) {
+	std::cout << "NoGo-Endgame: ";
+	std::copy(argv, argv + argc, std::ostream_iterator<const char*>(std::cout, " "));
+	std::cout << std::endl << std::endl;
+
+	std::string output = "endgame.db";
+	unsigned moves = 10;
+	size_t games = 1000;
+	size_t threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	unsigned seed = 0;
+	for (int i = 1; i < argc; i++) {
+		std::string para(argv[i]);
+		if (para.find("--output=") == 0) {
+			output = para.substr(para.find("=") + 1);
+		} else if (para.find("--moves=") == 0) {
+			moves = std::stoul(para.substr(para.find("=") + 1));
+		} else if (para.find("--games=") == 0) {
+			games = std::stoull(para.substr(para.find("=") + 1));
+		} else if (para.find("--threads=") == 0) {
+			threads = std::max<size_t>(std::stoull(para.substr(para.find("=") + 1)), 1);
+		} else if (para.find("--seed=") == 0) {
+			seed = std::stoul(para.substr(para.find("=") + 1));
+		}
+	}
+
+	// each game is played randomly until the side to move has at most the given number of legal moves,
+	// and the endgame is then solved exhaustively, the games are shared by the threads through a counter
+	auto start = std::chrono::steady_clock::now();
+	std::atomic<size_t> next(0);
+	std::mutex merge;
+	std::vector<uint64_t> records;
+	auto work = [&]() {
+		endgame_generator generator(moves);
+		while (true) {
+			size_t game = next++;
+			if (game >= games) break;
+			std::default_random_engine engine(seed + game);
+			board state;
+			std::vector<int> cells(board::size_x * board::size_y);
+			for (size_t i = 0; i < cells.size(); i++) cells[i] = i;
+			while (mobility(state) > moves) {
+				std::shuffle(cells.begin(), cells.end(), engine);
+				for (int i : cells) {
+					if (action::place(i, state.info().who_take_turns).apply(state) == board::legal) break;
+				}
+			}
+			generator.solve(state);
+			if ((game + 1) % 100 == 0) {
+				std::lock_guard<std::mutex> lock(merge);
+				std::cerr << (game + 1) << "/" << games << " games" << std::endl;
+			}
+		}
+		std::lock_guard<std::mutex> lock(merge);
+		records.insert(records.end(), generator.results().begin(), generator.results().end());
+	};
+	std::vector<std::thread> workers;
+	for (size_t i = 0; i < threads; i++) workers.emplace_back(work);
+	for (std::thread& worker : workers) worker.join();
+
+	if (!endgame_db::write(output, records, moves)) {
+		std::cerr << "cannot write " << output << std::endl;
+		return 1;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << records.size() << " positions with at most " << moves << " legal moves from " << games << " games, "
+	          << "written to " << output << " in " << seconds << " seconds" << std::endl;
+	return 0;
+}
@@ -0,0 +1,144 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * endgame.h: Database of perfectly solved endgames
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "board.h"
+
+/**
+ * a read-only database of solved endgames, generated offline (see endgame.cpp) and keyed by the canonical hash
+ *
+ * the file is a header, an index of the records by the top bits of the keys, and the records sorted by the keys
+ * a record packs the upper 56 bits of the key, the result (0x80 for a win), and the winning move (0x7f if none)
+ * in the coordinates of the canonical symmetry, which is the same encoding as solved_cache
+ * the file is memory-mapped, and a probe is a binary search within a single index bucket without allocation
+ */
+class endgame_db {
+public:
+	enum result_type { unknown = 0, win = 1, loss = -1 };
+
+public:
+	endgame_db() : header(nullptr), index(nullptr), records(nullptr), length(0) {}
+	~endgame_db() { close(); }
+	endgame_db(const endgame_db&) = delete;
+	endgame_db& operator =(const endgame_db&) = delete;
+
+	/**
+	 * map the database file, return false if it cannot be opened or is not a database
+	 */
+	bool open(const std::string& path) {
+		close();
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) return false;
+		struct stat st;
+		void* mapped = MAP_FAILED;
+		if (::fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(layout)) {
+			length = st.st_size;
+			mapped = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+		}
+		::close(fd);
+		if (mapped == MAP_FAILED) return length = 0, false;
+
+		const layout* h = static_cast<const layout*>(mapped);
+		size_t expected = sizeof(layout) + ((size_t(1) << h->index_bits) + 1) * sizeof(uint32_t) + h->count * sizeof(uint64_t);
+		if (std::memcmp(h->magic, magic(), sizeof(h->magic)) != 0 || h->index_bits > 24 || length != expected) {
+			::munmap(mapped, length);
+			return length = 0, false;
+		}
+		header = h;
+		index = reinterpret_cast<const uint32_t*>(h + 1);
+		records = reinterpret_cast<const uint64_t*>(index + (size_t(1) << h->index_bits) + 1);
+		return true;
+	}
+
+	void close() {
+		if (header) ::munmap(const_cast<layout*>(header), length);
+		header = nullptr;
+		index = nullptr;
+		records = nullptr;
+		length = 0;
+	}
+
+	bool is_open() const { return header; }
+	size_t size() const { return header ? header->count : 0; }
+	unsigned max_moves() const { return header ? header->moves : 0; }
+
+	/**
+	 * the result of a position for its side to move, and its winning move if any (-1 if none)
+	 */
+	int probe(uint64_t key, int* move = nullptr) const {
+		if (!header) return unknown;
+		size_t b = header->index_bits ? key >> (64 - header->index_bits) : 0;
+		const uint64_t* first = records + index[b];
+		const uint64_t* last = records + index[b + 1];
+		const uint64_t* it = std::lower_bound(first, last, key & ~uint64_t(0xff));
+		if (it == last || ((*it ^ key) >> 8)) return unknown;
+		if (move) *move = (*it & 0x7f) != 0x7f ? int(*it & 0x7f) : -1;
+		return *it & 0x80 ? win : loss;
+	}
+
+	/**
+	 * pack a solved position into a record
+	 */
+	static uint64_t record(uint64_t key, int result, int move = -1) {
+		return (key & ~uint64_t(0xff)) | (result == win ? 0x80 : 0) | (move >= 0 ? move : 0x7f);
+	}
+
+	/**
+	 * write the records into a database file, where moves is the bound of the legal moves of the positions
+	 * the records are sorted and deduplicated in place, return false if the file cannot be written
+	 */
+	static bool write(const std::string& path, std::vector<uint64_t>& list, unsigned moves) {
+		std::sort(list.begin(), list.end());
+		list.erase(std::unique(list.begin(), list.end(), [](uint64_t a, uint64_t b) { return (a >> 8) == (b >> 8); }), list.end());
+
+		layout h;
+		std::memcpy(h.magic, magic(), sizeof(h.magic));
+		h.moves = moves;
+		h.index_bits = 0;
+		while (h.index_bits < 24 && (size_t(8) << h.index_bits) < list.size()) h.index_bits++; // about 8 records per bucket
+		h.count = list.size();
+
+		std::vector<uint32_t> offsets((size_t(1) << h.index_bits) + 1, 0);
+		for (uint64_t r : list) offsets[(h.index_bits ? r >> (64 - h.index_bits) : 0) + 1]++;
+		for (size_t b = 1; b < offsets.size(); b++) offsets[b] += offsets[b - 1];
+
+		std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!out.is_open()) return false;
+		out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+		out.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint32_t));
+		out.write(reinterpret_cast<const char*>(list.data()), list.size() * sizeof(uint64_t));
+		return bool(out.flush());
+	}
+
+private:
+	struct layout {
+		char magic[8];
+		uint32_t moves;      // the positions have at most this number of legal moves
+		uint32_t index_bits; // the index has 2^index_bits + 1 offsets
+		uint64_t count;      // the number of records
+	};
+
+	static const char* magic() { return "NOGOEDB1"; }
+
+private:
+	const layout* header;
+	const uint32_t* index;
+	const uint64_t* records;
+	size_t length;
+};
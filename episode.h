@@ -15,14 +15,20 @@
 #include <sstream>
 #include <chrono>
 #include <numeric>
+#include <iomanip>
+#include <cmath>
 #include "board.h"
 #include "action.h"
 #include "agent.h"
 
 class statistic;
+class episode_writer;
+class episode_reader;
 
 class episode {
 friend class statistic;
+friend class episode_writer;
+friend class episode_reader;
 public:
 	episode() : ep_state(initial_state()), ep_score(0), ep_time(0) {
 		ep_moves.reserve(board::size_x * board::size_y);
@@ -32,6 +38,7 @@ public:
 	board& state() { return ep_state; }
 	const board& state() const { return ep_state; }
 	board::reward score() const { return ep_score; }
+	bool is_terminal() const { return !ep_state.has_legal_move(ep_state.info().who_take_turns); }
 
 	void open_episode(const std::string& tag) {
 		ep_open = { tag, millisec() };
@@ -39,15 +46,18 @@ public:
 	void close_episode(const std::string& tag) {
 		ep_close = { tag, millisec() };
 	}
-	bool apply_action(action move) {
+	/**
+	 * apply a move, which is recorded with its time since take_turns() and the counters of its search
+	 */
+	bool apply_action(action move, const search_info& info = {}) {
 		board::reward reward = move.apply(state());
 		if (reward != board::legal) return false;
-		ep_moves.emplace_back(move, reward, millisec() - ep_time);
+		ep_moves.emplace_back(move, reward, microsec() - ep_time, info);
 		ep_score += reward;
 		return true;
 	}
 	agent& take_turns(agent& black, agent& white) {
-		ep_time = millisec();
+		ep_time = microsec();
 		return (step() % 2) ? white : black;
 	}
 	agent& last_turns(agent& black, agent& white) {
@@ -67,6 +77,9 @@ public:
 		}
 	}
 
+	/**
+	 * the thinking time of the moves in microseconds
+	 */
 	time_t time(unsigned who = -1u) const {
 		time_t time = 0;
 		switch (who) {
@@ -80,12 +93,23 @@ public:
 			break;
 		case action::place::type:
 		default:
-			time = ep_close.when - ep_open.when;
+			for (size_t i = 0; i < ep_moves.size(); i++) time += ep_moves[i].time;
 			break;
 		}
 		return time;
 	}
 
+	/**
+	 * the simulated games of the searches of the moves
+	 */
+	size_t playouts(unsigned who = -1u) const {
+		size_t playouts = 0;
+		size_t first = (who == board::white || who == action::white::type) ? 1 : 0;
+		size_t stride = (who == -1u || who == action::place::type) ? 1 : 2;
+		for (size_t i = first; i < ep_moves.size(); i += stride) playouts += ep_moves[i].info.playouts;
+		return playouts;
+	}
+
 	std::vector<action> actions(unsigned who = -1u) const {
 		std::vector<action> res;
 		switch (who) {
@@ -149,27 +173,110 @@ public:
 		return in;
 	}
 
+	/**
+	 * parse an episode from a line of the text format, which is the same as operator >> but without streams,
+	 * so that a line is parsed in place without allocations other than the tags of the episode
+	 * return false if the line is not an episode, e.g., of a move with an unknown side or out of the board
+	 */
+	bool parse(const char* first, const char* last) {
+		*this = {};
+		static const char header[] = "C[TCG|";
+		const char* p = std::search(first, last, header, header + 6);
+		if (p == last) return false;
+		p += 6;
+		if (!parse_meta(p, last, ep_open) || p == last || *p++ != '|' || !parse_meta(p, last, ep_close)) return false;
+		for (p = std::find(p, last, ';'); last - p >= 6 && *p == ';'; ) {
+			unsigned who = board::empty;
+			if (p[1] == 'B') who = board::black;
+			if (p[1] == 'W') who = board::white;
+			int x = p[3] - 'a';
+			int y = (board::size_y - 1) - (p[4] - 'a');
+			if (who == board::empty || x < 0 || x >= board::size_x || y < 0 || y >= board::size_y) return false;
+			ep_moves.emplace_back(action::place(x, y, who));
+			p += 6;
+			if (p == last || *p != 'C') continue;
+			move& m = ep_moves.back();
+			int64_t ms = 0, us = 0, depth = 0, result = 0;
+			p += 2; // C[
+			parse_int(p, last, ms);
+			if (p != last && *p == '.') { // the fraction in microseconds, rounded
+				int digits = 0;
+				for (p++; p != last && *p >= '0' && *p <= '9'; p++, digits++) {
+					if (digits < 3) us = us * 10 + (*p - '0');
+					else if (digits == 3 && *p >= '5') us++;
+				}
+				for (; digits < 3; digits++) us *= 10;
+			}
+			m.time = ms * 1000 + us;
+			if (p != last && *p == '|') {
+				int64_t v[3] = {};
+				for (int64_t& n : v) parse_int(++p, last, n);
+				parse_int(++p, last, depth);
+				parse_int(++p, last, result);
+				m.info.iterations = v[0];
+				m.info.playouts = v[1];
+				m.info.nodes = v[2];
+				m.info.depth = depth;
+				m.info.result = result;
+			}
+			if (p != last) p++; // ]
+		}
+		return true;
+	}
+
 protected:
 
+	/**
+	 * a move with its time in microseconds and the counters of its search
+	 *
+	 * the comment of a move in the text format is the time in milliseconds, followed by the counters if any, e.g.,
+	 * C[12.345|iterations,playouts,nodes,depth,result], and a time without fraction is of the older logs
+	 */
 	struct move {
 		action code;
 		board::reward reward;
 		time_t time;
-		move(action code = {}, board::reward reward = 0, time_t time = 0) : code(code), reward(reward), time(time) {}
+		search_info info;
+		move(action code = {}, board::reward reward = 0, time_t time = 0, const search_info& info = {})
+			: code(code), reward(reward), time(time), info(info) {}
 
 		operator action() const { return code; }
 		friend std::ostream& operator <<(std::ostream& out, const move& m) {
 			out << m.code;
-			if (m.time) out << "C[" << std::dec << m.time << "]";
+			bool counted = m.info.iterations || m.info.playouts || m.info.nodes || m.info.depth || m.info.result;
+			if (m.time || counted) {
+				char fill = out.fill('0');
+				out << "C[" << std::dec << m.time / 1000 << '.' << std::setw(3) << m.time % 1000;
+				out.fill(fill);
+				if (counted) {
+					out << '|' << m.info.iterations << ',' << m.info.playouts << ',' << m.info.nodes
+					    << ',' << m.info.depth << ',' << int(m.info.result);
+				}
+				out << "]";
+			}
 			return out;
 		}
 		friend std::istream& operator >>(std::istream& in, move& m) {
 			in >> m.code;
 			m.reward = 0;
 			m.time = 0;
+			m.info = {};
 			if (in.peek() == 'C') {
 				in.ignore(2); // C[
-				in >> std::dec >> m.time;
+				double ms = 0;
+				in >> std::dec >> ms;
+				m.time = std::llround(ms * 1000);
+				if (in.peek() == '|') {
+					unsigned depth;
+					int result;
+					in.ignore(1) >> m.info.iterations;
+					in.ignore(1) >> m.info.playouts;
+					in.ignore(1) >> m.info.nodes;
+					in.ignore(1) >> depth;
+					in.ignore(1) >> result;
+					m.info.depth = depth;
+					m.info.result = result;
+				}
 				in.ignore(1); // ]
 			}
 			return in;
@@ -189,6 +296,25 @@ protected:
 		}
 	};
 
+	static bool parse_int(const char*& p, const char* last, int64_t& v) {
+		bool negative = p != last && *p == '-';
+		if (negative) p++;
+		if (p == last || *p < '0' || *p > '9') return false;
+		for (v = 0; p != last && *p >= '0' && *p <= '9'; p++) v = v * 10 + (*p - '0');
+		if (negative) v = -v;
+		return true;
+	}
+	static bool parse_meta(const char*& p, const char* last, meta& m) {
+		const char* at = std::find(p, last, '@');
+		if (at == last) return false;
+		m.tag.assign(p, at);
+		p = at + 1;
+		int64_t when;
+		if (!parse_int(p, last, when)) return false;
+		m.when = when;
+		return true;
+	}
+
 	static board initial_state() {
 		return {};
 	}
@@ -196,6 +322,10 @@ protected:
 		auto now = std::chrono::system_clock::now().time_since_epoch();
 		return std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
 	}
+	static time_t microsec() {
+		auto now = std::chrono::steady_clock::now().time_since_epoch();
+		return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+	}
 
 private:
 	board ep_state;
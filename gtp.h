@@ -0,0 +1,441 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * gtp.h: Asynchronous GTP shell
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include "board.h"
+#include "action.h"
+#include "agent.h"
+#include "episode.h"
+#include "statistic.h"
+
+/**
+ * a pool of search threads shared by the shells of a server, see server.h
+ * the tasks are run in the order they are submitted, and since a shell has at most one search at a time,
+ * the searches of the shells are scheduled in turn
+ * an unbounded task, e.g., a ponder, should yield its worker by submitting itself again when others are waiting
+ */
+class worker_pool {
+public:
+	worker_pool(size_t workers) : closed(false) {
+		for (size_t i = 0; i < std::max<size_t>(workers, 1); i++) threads.emplace_back([this]() { work(); });
+	}
+	~worker_pool() {
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			closed = true;
+		}
+		ready.notify_all();
+		for (std::thread& thread : threads) thread.join();
+	}
+	worker_pool(const worker_pool&) = delete;
+	worker_pool& operator =(const worker_pool&) = delete;
+
+	template<class task_type>
+	std::future<typename std::result_of<task_type()>::type> submit(task_type task) {
+		typedef typename std::result_of<task_type()>::type result_type;
+		std::shared_ptr<std::packaged_task<result_type()>> job = std::make_shared<std::packaged_task<result_type()>>(task);
+		std::lock_guard<std::mutex> guard(lock);
+		tasks.emplace_back([job]() { (*job)(); });
+		ready.notify_one();
+		return job->get_future();
+	}
+
+	size_t size() const { return threads.size(); }
+
+	/**
+	 * the number of the submitted tasks which are waiting for a worker
+	 */
+	size_t waiting() {
+		std::lock_guard<std::mutex> guard(lock);
+		return tasks.size();
+	}
+
+private:
+	void work() {
+		for (std::function<void()> task; ; task()) {
+			std::unique_lock<std::mutex> guard(lock);
+			ready.wait(guard, [this]() { return tasks.size() || closed; });
+			if (tasks.empty()) return;
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+	}
+
+private:
+	std::vector<std::thread> threads;
+	std::deque<std::function<void()>> tasks;
+	std::mutex lock;
+	std::condition_variable ready;
+	bool closed;
+};
+
+/**
+ * the GTP shell of a game between two agents, where the commands are read by a reader thread into a queue,
+ * a generated move is searched by a search thread, and every response is flushed at once
+ *
+ * a "quit" or the end of the input arriving during a search stops the search, so that the shell does not wait for
+ * a long genmove, where the move is still replied with the best move so far before the shell quits
+ * (the commands queued before the search, e.g., of a script, are executed normally)
+ * the searches are run by a worker pool if given, e.g., shared by the sessions of a server, or by their own threads
+ * the commands may have ids, i.e., "[id] command [arguments]", and the responses are "=[id] result" or "?[id] error"
+ *
+ * the analysis commands of Leela Zero are also supported, whose responses are streamed while searching
+ * "lz-analyze [color] [interval]" searches the current position until the next command arrives, and
+ * (with a worker pool, the search is resumed at the end of the queue every second if other searches are waiting)
+ * "lz-genmove_analyze [color] [interval]" generates and plays a move as genmove, whose response ends with "play <move>"
+ * every interval (in centiseconds) a line of the root children is printed, sorted by their visits, as
+ * "info move <move> visits <n> winrate <w> rave <r> [proof win|loss] order <k> pv <moves>" for each child,
+ * where the rates are for the side to move in 1/10000, and the statistics are published by the search itself
+ */
+class gtp_shell {
+public:
+	gtp_shell(statistic& stat, agent& black, agent& white, const std::string& name, const std::string& version,
+			worker_pool* pool = nullptr)
+		: stat(stat), black(black), white(white), name(name), version(version), pool(pool), stream(nullptr), interval(0) {}
+
+	/**
+	 * serve the commands of the input until "quit" or the end of the input
+	 * return false if the shell is terminated by an error, e.g., a player mismatch or an illegal move
+	 * the reader is left blocked by the input after an error, unless hangup is given to unblock it, e.g., of a socket
+	 */
+	bool run(std::istream& in, std::ostream& out, std::function<void()> hangup = nullptr) {
+		std::shared_ptr<channel> queue = std::make_shared<channel>();
+		std::thread reader([queue, &in]() {
+			for (std::string line; std::getline(in, line); ) {
+				command cmd;
+				if (!parse(line, cmd)) continue;
+				bool quit = cmd.args[0] == "quit";
+				queue->push(std::move(cmd));
+				if (quit) return;
+			}
+			queue->close();
+		});
+
+		bool ok = true;
+		for (command cmd; queue->pop(cmd); ) {
+			std::string reply;
+			bool quit = false;
+			if (cmd.args[0] == "lz-analyze" || cmd.args[0] == "lz-genmove_analyze") {
+				if (analyze(cmd, out, quit, ok, *queue)) {
+					if (quit || !ok) break;
+					continue;
+				}
+				reply = "syntax error";
+			}
+			bool success = reply.empty() && execute(cmd.args, reply, quit, ok, *queue);
+			std::string response = (success ? "=" : "?") + cmd.id + (reply.size() ? " " + reply : "") + "\n\n";
+			out.write(response.data(), response.size());
+			out.flush();
+			if (quit || !ok) break;
+		}
+
+		// the reader may be blocked by the input after an error, which then leaves with the process
+		if (!ok && hangup) hangup();
+		if (ok || hangup) reader.join();
+		else reader.detach();
+		return ok;
+	}
+
+protected:
+	struct command {
+		std::string id;
+		std::vector<std::string> args;
+	};
+
+	/**
+	 * the queue of the commands shared with the reader thread, which also stops the running search at "quit"
+	 */
+	struct channel {
+		std::mutex lock;
+		std::condition_variable ready;
+		std::deque<command> commands;
+		bool closed = false;
+		agent* searching = nullptr;
+
+		void push(command&& cmd) {
+			std::lock_guard<std::mutex> guard(lock);
+			if (cmd.args[0] == "quit" && searching) searching->stop();
+			commands.push_back(std::move(cmd));
+			ready.notify_one();
+		}
+		void close() {
+			std::lock_guard<std::mutex> guard(lock);
+			if (searching) searching->stop();
+			closed = true;
+			ready.notify_one();
+		}
+		bool wait_for(std::chrono::milliseconds timeout) {
+			std::unique_lock<std::mutex> guard(lock);
+			return ready.wait_for(guard, timeout, [this]() { return commands.size() || closed; });
+		}
+		bool pop(command& cmd) {
+			std::unique_lock<std::mutex> guard(lock);
+			ready.wait(guard, [this]() { return commands.size() || closed; });
+			if (commands.empty()) return false;
+			cmd = std::move(commands.front());
+			commands.pop_front();
+			return true;
+		}
+		void search(agent* who) {
+			std::lock_guard<std::mutex> guard(lock);
+			searching = who;
+		}
+	};
+
+	/**
+	 * split a line into the id and the arguments, where the comments and the control characters are removed
+	 * return false if the line has no command
+	 */
+	static bool parse(const std::string& line, command& cmd) {
+		cmd.id.clear();
+		cmd.args.clear();
+		std::string token;
+		for (size_t i = 0; i <= line.size() && (i == line.size() || line[i] != '#'); i++) {
+			char c = i < line.size() ? line[i] : ' ';
+			if (c == ' ' || c == '\t') {
+				if (token.size()) cmd.args.push_back(std::move(token));
+				token.clear();
+			} else if (c >= 32 && c != 127) {
+				token.push_back(c);
+			}
+		}
+		if (token.size()) cmd.args.push_back(std::move(token));
+		if (cmd.args.size() && cmd.args[0].find_first_not_of("0123456789") == std::string::npos) {
+			cmd.id = cmd.args[0];
+			cmd.args.erase(cmd.args.begin());
+		}
+		return cmd.args.size();
+	}
+
+	/**
+	 * search a move by the search thread, where the move is the best so far if the search is stopped
+	 */
+	action search(agent& who, const board& state, channel& queue) {
+		who.stop(false);
+		queue.search(&who);
+		auto task = [&]() { return who.take_action(state); };
+		std::future<action> result = pool ? pool->submit(task) : std::async(std::launch::async, task);
+		if (stream) {
+			while (result.wait_for(interval) != std::future_status::ready) print(who, *stream);
+		}
+		action move = result.get();
+		if (stream) print(who, *stream);
+		queue.search(nullptr);
+		return move;
+	}
+
+	/**
+	 * execute an analysis command with streamed response, return false if its arguments are invalid
+	 */
+	bool analyze(const command& cmd, std::ostream& out, bool& quit, bool& ok, channel& queue) {
+		std::string color;
+		int centisec = 0;
+		for (size_t i = 1; i < cmd.args.size(); i++) {
+			const std::string& arg = cmd.args[i];
+			if (arg == "interval" && i + 1 < cmd.args.size()) {
+				centisec = std::atoi(cmd.args[++i].c_str());
+			} else if (arg.find_first_not_of("0123456789") == std::string::npos) {
+				centisec = std::atoi(arg.c_str());
+			} else if (color.empty() && std::string("bwBW").find(arg[0]) != std::string::npos) {
+				color = arg;
+			} // other arguments of Leela Zero, e.g., "minmoves", are ignored
+		}
+		if (cmd.args[0] == "lz-genmove_analyze" && color.empty()) return false;
+		board state = stat.is_episode_ongoing() ? stat.back().state() : board();
+		agent& who = state.info().who_take_turns == board::white ? white : black;
+		if (color.size() && who.role()[0] != std::tolower(color[0]) && cmd.args[0] == "lz-analyze") return false;
+
+		std::string head = "=" + cmd.id + "\n";
+		out.write(head.data(), head.size());
+		out.flush();
+		stream = &out;
+		interval = std::chrono::milliseconds(std::max(centisec, 1) * 10);
+		who.watch(interval.count());
+		if (cmd.args[0] == "lz-genmove_analyze") { // the same as genmove, but with the response of "play <move>"
+			std::string reply;
+			execute({ "genmove", color }, reply, quit, ok, queue);
+			std::string tail = "play " + reply + "\n\n";
+			out.write(tail.data(), tail.size());
+		} else { // search until the next command, which is then executed as usual
+			// a ponder of a pool runs by time slices, so that it never holds a worker while other searches are waiting
+			const std::chrono::milliseconds slice(1000);
+			std::chrono::steady_clock::time_point printed = std::chrono::steady_clock::now();
+			queue.search(&who);
+			for (bool next = false; !next; ) {
+				std::atomic<bool> started(false);
+				auto task = [&]() { started = true; who.ponder(state); }; // an interrupted ponder is resumed
+				who.stop(false);
+				std::future<void> result = pool ? pool->submit(task) : std::async(std::launch::async, task);
+				std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::time_point::max();
+				while (!(next = queue.wait_for(std::min(interval, slice)))) {
+					std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+					if (now - printed >= interval) print(who, out), printed = now;
+					if (started && begin == std::chrono::steady_clock::time_point::max()) begin = now;
+					if (pool && started && now - begin >= slice && pool->waiting()) break;
+				}
+				who.stop();
+				result.get();
+			}
+			who.stop(false);
+			queue.search(nullptr);
+			print(who, out);
+			out.write("\n", 1);
+		}
+		out.flush();
+		who.watch(0);
+		stream = nullptr;
+		return true;
+	}
+
+	/**
+	 * print a line of the latest statistics of a search, if any
+	 */
+	static void print(agent& who, std::ostream& out) {
+		std::vector<root_report> list;
+		if (!who.report(list) || list.empty()) return;
+		std::string line;
+		for (size_t k = 0; k < list.size(); k++) {
+			const root_report& r = list[k];
+			line += (k ? " " : "") + std::string("info move ") + std::string(board::point(r.move));
+			line += " visits " + std::to_string(r.visits);
+			line += " winrate " + std::to_string(int(r.winrate * 10000 + 0.5f));
+			line += " rave " + std::to_string(int(r.amaf * 10000 + 0.5f));
+			if (r.proof != mcts_tree::unknown) line += r.proof == mcts_tree::win ? " proof win" : " proof loss";
+			line += " order " + std::to_string(k) + " pv";
+			for (int move : r.pv) line += " " + std::string(board::point(move));
+		}
+		line += "\n";
+		out.write(line.data(), line.size());
+		out.flush();
+	}
+
+	/**
+	 * execute a command, return false if the command fails
+	 * quit is set if the shell should quit, and ok is cleared if the shell should be terminated by an error
+	 */
+	bool execute(const std::vector<std::string>& args, std::string& reply, bool& quit, bool& ok, channel& queue) {
+		if (args[0] == "play" || args[0] == "genmove") { // play a move, or generate a move and play
+			if (args.size() < 2 || (args[0] == "play" && args.size() < 3)) return reply = "syntax error", false;
+			if (!stat.is_episode_ongoing()) { // should open an episode
+				black.open_episode("~:" + white.name());
+				white.open_episode(black.name() + ":~");
+				stat.open_episode(black.name() + ":" + white.name());
+			}
+
+			episode& game = stat.back();
+			agent& who = game.take_turns(black, white);
+			if (who.role()[0] != std::tolower(args[1][0])) { // player mismatch?!
+				reply = "resign";
+				// show the error message and terminate the shell
+				std::cerr << "player color " << args[1] << " mismatch!" << std::endl;
+				std::cerr << "current state, "
+				          << who.role() << " to play: " << std::endl << game.state();
+				return ok = false, true;
+			}
+			if (args[0] == "play") { // play a move
+				std::string types = "?bw"; // black == 1, white == 2
+				action::place move(args[2], types.find(who.role()[0]));
+				if (game.apply_action(move) != true) { // remote plays an illegal move?!
+					reply = "resign";
+					// show the error message and terminate the shell
+					std::cerr << who.role() << " plays an illegal action!" << std::endl;
+					const char* reason[] = {
+						"legal",
+						"illegal_turn",
+						"illegal_pass",
+						"illegal_out_of_range",
+						"illegal_not_empty",
+						"illegal_suicide",
+						"illegal_take",
+						"unknown",
+					};
+					std::cerr << "current state: " << std::endl << game.state();
+					int code = move.apply(game.state());
+					std::cerr << "action: " << args[1] << " " << args[2] << std::endl;
+					std::cerr << "reason: " << reason[std::min(-code, 7)] << std::endl;
+					return ok = false, true;
+				}
+			} else if (args[0] == "genmove") { // generate a move and play
+				action::place move = game.is_terminal() ? action::place() : search(who, game.state(), queue);
+				if (game.apply_action(move, who.last_search()) == true) {
+					reply = move.position();
+				} else { // I have no legal move to play
+					reply = "resign";
+				}
+			}
+
+		} else if (args[0] == "clear_board" || args[0] == "quit") { // reset game, or quit
+			if (stat.is_episode_ongoing()) { // should close an opened episode
+				agent& win = stat.back().last_turns(black, white);
+				stat.close_episode(win.name());
+				black.close_episode(win.name());
+				white.close_episode(win.name());
+			}
+			quit = (args[0] == "quit"); // quit GTP shell
+
+		} else if (args[0] == "showboard") { // print the board
+			std::stringstream buf;
+			buf << (stat.is_episode_ongoing() ? stat.back().state() : board());
+			reply = "\n" + buf.str();
+			reply.pop_back(); // remove a new line
+
+		} else if (args[0] == "boardsize") { // set the board size
+			if (args.size() < 2) return reply = "syntax error", false;
+			size_t size = std::stoul(args[1]);
+			if (size != board::size_x || size != board::size_y) {
+				std::cerr << "board size mismatch: " << args[1] << std::endl;
+			}
+			if (size > board::size_x || size > board::size_y) return reply = "unacceptable size", ok = false, false;
+
+		} else if (args[0] == "name") { // report the name of the program
+			reply = name;
+		} else if (args[0] == "version") { // report the version number of the program
+			reply = version;
+		} else if (args[0] == "protocol_version") { // report GTP protocol version
+			reply = "2";
+		} else if (args[0] == "known_command") { // report whether a command is supported
+			reply = args.size() > 1 && commands().find("\n" + args[1] + "\n") != std::string::npos ? "true" : "false";
+		} else if (args[0] == "list_commands") { // print supported commands
+			reply = commands().substr(1);
+			reply.pop_back(); // remove a new line
+		} else {
+			return reply = "unknown command", false;
+		}
+		return true;
+	}
+
+	static std::string commands() {
+		return "\n" "play\n" "genmove\n" "clear_board\n" "showboard\n" "boardsize\n"
+		       "name\n" "version\n" "protocol_version\n" "known_command\n" "list_commands\n" "quit\n"
+		       "lz-analyze\n" "lz-genmove_analyze\n";
+	}
+
+protected:
+	statistic& stat;
+	agent& black;
+	agent& white;
+	std::string name;
+	std::string version;
+	worker_pool* pool;
+	std::ostream* stream; // the output of the streamed statistics while searching, if any
+	std::chrono::milliseconds interval;
+};
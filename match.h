@@ -0,0 +1,351 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * match.h: Native match runner between two programs or players
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <chrono>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "board.h"
+#include "action.h"
+#include "agent.h"
+#include "episode.h"
+#include "statistic.h"
+
+/**
+ * a GTP program run as a subprocess by "/bin/sh -c command", which plays as an agent of either side
+ *
+ * the moves of the opponent are sent by "play" before every "genmove", found by comparing the board with the board
+ * known by the program, which is exact since no stone is ever removed in NoGo
+ * the program is launched at the first episode, and is killed with its process group by stop(), e.g., when it runs out of time,
+ * so that a hanging program never blocks the match, and a killed program is launched again at the next episode
+ */
+class gtp_engine : public agent {
+public:
+	gtp_engine(const std::string& command, const std::string& args = "")
+		: agent(args), command(command), pid(-1), to(-1), from(-1) {}
+	gtp_engine(const gtp_engine&) = delete;
+	gtp_engine& operator =(const gtp_engine&) = delete;
+	~gtp_engine() { close(); }
+
+	virtual void open_episode(const std::string& flag = "") {
+		if (pid < 0 && launch()) ask("boardsize " + std::to_string(board::size_x));
+		ask("clear_board");
+		known = board();
+	}
+
+	virtual action take_action(const board& state) {
+		if (pid < 0) return action();
+		for (int i = 0; i < board::size_x * board::size_y; i++) { // the moves since the last genmove
+			if (state(i) == known(i)) continue;
+			if (!ask(std::string("play ") + color(state(i)) + " " + std::string(board::point(i)))) return action();
+		}
+		known = state;
+		unsigned who = state.info().who_take_turns;
+		std::string reply;
+		if (!ask(std::string("genmove ") + color(who), &reply, -1)) return action();
+		std::transform(reply.begin(), reply.end(), reply.begin(), ::toupper);
+		if (reply == "RESIGN" || reply == "PASS") return action();
+		action::place move(board::point(reply), who);
+		move.apply(known);
+		return move;
+	}
+
+	/**
+	 * kill the program, which may be called from another thread, e.g., to abort a genmove
+	 */
+	virtual void stop(bool flag = true) {
+		pid_t running = pid;
+		if (flag && running > 0) ::kill(-running, SIGKILL);
+	}
+
+	void close() {
+		if (pid < 0) return;
+		if (to >= 0) {
+			static const char quit[] = "quit\n";
+			if (::write(to, quit, sizeof(quit) - 1) < 0) {} // the program may have been killed
+			::close(to);
+		}
+		if (from >= 0) ::close(from);
+		::waitpid(pid, nullptr, 0);
+		pid = -1;
+		to = from = -1;
+	}
+
+protected:
+	static char color(unsigned who) { return who == board::black ? 'b' : 'w'; }
+
+	bool launch() {
+		int down[2], up[2];
+		// the pipes are closed on exec, so that the programs of the other workers never hold them
+		if (::pipe2(down, O_CLOEXEC) != 0) return false;
+		if (::pipe2(up, O_CLOEXEC) != 0) return ::close(down[0]), ::close(down[1]), false;
+		pid_t child = ::fork();
+		if (child == 0) { // in its own process group, so that the processes launched by the shell are killed together
+			::setpgid(0, 0);
+			::dup2(down[0], 0);
+			::dup2(up[1], 1);
+			::close(down[0]), ::close(down[1]), ::close(up[0]), ::close(up[1]);
+			::execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char*>(nullptr));
+			::_exit(127);
+		}
+		::close(down[0]);
+		::close(up[1]);
+		if (child < 0) return ::close(down[1]), ::close(up[0]), false;
+		pid = child;
+		to = down[1];
+		from = up[0];
+		buffer.clear();
+		return true;
+	}
+
+	/**
+	 * send a command and wait for its response for at most the given milliseconds (-1 for no limit)
+	 * return true if it succeeds, where the lines before the response, e.g., a banner, are skipped
+	 * the program is closed if it fails to respond
+	 */
+	bool ask(const std::string& cmd, std::string* reply = nullptr, int millisec = 60000) {
+		if (pid < 0) return false;
+		std::string line = cmd + "\n";
+		for (size_t sent = 0; sent < line.size(); ) {
+			ssize_t n = ::write(to, line.data() + sent, line.size() - sent);
+			if (n < 0 && errno == EINTR) continue;
+			if (n <= 0) return close(), false;
+			sent += n;
+		}
+		std::string response;
+		bool started = false;
+		while (read_line(line, millisec)) {
+			if (!started) {
+				started = line.size() && (line[0] == '=' || line[0] == '?');
+				if (started) response = line;
+			} else if (line.empty()) {
+				if (reply) *reply = response.substr(std::min(response.find_first_of(" \t"), response.size()));
+				if (reply) reply->erase(0, std::min(reply->find_first_not_of(" \t"), reply->size()));
+				return response[0] == '=';
+			} else {
+				response += "\n" + line;
+			}
+		}
+		close();
+		return false;
+	}
+
+	bool read_line(std::string& line, int millisec) {
+		for (size_t end; (end = buffer.find('\n')) == std::string::npos; ) {
+			pollfd p = { from, POLLIN, 0 };
+			int ready = ::poll(&p, 1, millisec);
+			if (ready < 0 && errno == EINTR) continue;
+			if (ready <= 0) return false;
+			char chunk[4096];
+			ssize_t n = ::read(from, chunk, sizeof(chunk));
+			if (n < 0 && errno == EINTR) continue;
+			if (n <= 0) return false;
+			buffer.append(chunk, n);
+		}
+		size_t end = buffer.find('\n');
+		line = buffer.substr(0, end);
+		buffer.erase(0, end + 1);
+		if (line.size() && line.back() == '\r') line.pop_back();
+		return true;
+	}
+
+private:
+	std::string command;
+	std::atomic<pid_t> pid;
+	int to;
+	int from;
+	std::string buffer;
+	board known;
+};
+
+/**
+ * the match between two players over many games in parallel, the native alternative to run-gogui-twogtp.sh
+ *
+ * a player is given by the arguments of an agent (see make_player), or by "gtp:command" for a GTP program
+ * the players swap their colors every game, i.e., P1 plays black in the even games and white in the odd games
+ * every worker plays its own games with its own players (or programs), where the agents are seeded by the worker index
+ * a move is checked by the rules as "nogo-judge --check" does, and a side loses a game by an illegal move (F),
+ * by using more than the time limit of its total thinking time in the game (T), or by resigning or having no legal
+ * move (R), where a move running out of time is stopped at once (see agent::stop and gtp_engine::stop)
+ * the games are recorded into the statistic in order, and are also written as a collection of SGF games
+ */
+class match_runner {
+public:
+	match_runner(const std::string& p1, const std::string& p2, size_t games, size_t workers, time_t limit)
+		: spec{ p1, p2 }, games(games), workers(std::max<size_t>(workers, 1)), limit(limit) {}
+
+	/**
+	 * play the games, write the SGF collection if a path is given, and print the summary
+	 * return false if the SGF file cannot be written
+	 */
+	bool run(statistic& stat, const std::string& sgf = "") {
+		std::signal(SIGPIPE, SIG_IGN); // a program may exit at any time, whose pipe is then broken
+		std::ofstream out;
+		if (sgf.size()) {
+			out.open(sgf, std::ios::out | std::ios::trunc);
+			if (!out.is_open()) return false;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		std::vector<result> results(games);
+		std::map<size_t, episode> finished; // the games waiting for the games before them
+		size_t merged = 0;
+		std::atomic<size_t> next(0);
+		std::mutex merge;
+		auto work = [&](size_t id) {
+			std::unique_ptr<agent> players[2][2]; // [P1 or P2][black or white]
+			for (size_t p = 0; p < 2; p++) {
+				std::string name = "name=P" + std::to_string(p + 1);
+				if (spec[p].find("gtp:") == 0) {
+					players[p][0].reset(new gtp_engine(spec[p].substr(4), name));
+				} else {
+					players[p][0] = make_player(seeded_args(name + " " + spec[p] + " role=black", id));
+					players[p][1] = make_player(seeded_args(name + " " + spec[p] + " role=white", id));
+				}
+			}
+			for (size_t k; (k = next++) < games; ) {
+				size_t p1 = k % 2; // P1 plays black in the even games
+				agent& black = players[p1][0] ? *players[p1][0] : *players[p1][1];
+				agent& white = players[1 - p1][1] ? *players[1 - p1][1] : *players[1 - p1][0];
+				episode game;
+				results[k] = play(game, black, white);
+				results[k].names[0] = black.name();
+				results[k].names[1] = white.name();
+
+				std::lock_guard<std::mutex> lock(merge);
+				finished.emplace(k, std::move(game));
+				for (auto it = finished.begin(); it != finished.end() && it->first == merged; it = finished.erase(it)) {
+					if (out.is_open()) out << sgf_of(it->second, results[merged]) << '\n';
+					stat.push_episode(std::move(it->second));
+					merged++;
+				}
+			}
+		};
+		std::vector<std::thread> threads;
+		for (size_t i = 1; i < std::min(workers, games); i++) threads.emplace_back(work, i);
+		work(0);
+		for (std::thread& thread : threads) thread.join();
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		summary(results, seconds);
+		return !out.is_open() || bool(out.flush());
+	}
+
+protected:
+	/**
+	 * the result of a game, where winner is the side of the winner
+	 */
+	struct result {
+		board::piece_type winner;
+		char reason;         // 'R' for resignation or no legal move, 'T' for time, 'F' for an illegal move
+		action::place fault; // the illegal move, if any
+		time_t time[2];      // the total thinking time of black and white in microseconds
+		std::string names[2];
+	};
+
+	result play(episode& game, agent& black, agent& white) {
+		result r = { board::empty, 'R', action::place(), { 0, 0 }, {} };
+		black.open_episode("~:" + white.name());
+		white.open_episode(black.name() + ":~");
+		game.open_episode(black.name() + ":" + white.name());
+		while (r.winner == board::empty) {
+			agent& who = game.take_turns(black, white);
+			unsigned side = game.state().info().who_take_turns;
+			board::piece_type other = side == board::black ? board::white : board::black;
+			if (!game.state().has_legal_move(side)) {
+				r.winner = other;
+				break;
+			}
+			auto start = std::chrono::steady_clock::now();
+			std::future<action> thinking = std::async(std::launch::async, [&]() { return who.take_action(game.state()); });
+			std::chrono::microseconds remain(limit * 1000 - r.time[side - 1]);
+			bool timeout = thinking.wait_for(std::max(remain, std::chrono::microseconds(0))) == std::future_status::timeout;
+			if (timeout) who.stop();
+			action move = thinking.get();
+			if (timeout) who.stop(false);
+			r.time[side - 1] += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+			if (timeout || r.time[side - 1] > limit * 1000) {
+				r.winner = other;
+				r.reason = 'T';
+			} else if (!game.apply_action(move, who.last_search())) {
+				r.winner = other;
+				if (move.type() == action::place::type) r.reason = 'F', r.fault = move;
+			}
+		}
+		agent& win = r.winner == board::black ? black : white;
+		game.close_episode(win.name());
+		black.close_episode(win.name());
+		white.close_episode(win.name());
+		return r;
+	}
+
+	/**
+	 * the SGF of a game, whose result is "B+R", "W+T", etc., where an illegal move is kept as the last move
+	 * and the thinking time of both sides in seconds is the comment of the game
+	 */
+	static std::string sgf_of(const episode& game, const result& r) {
+		std::stringstream ss;
+		ss << "(;GM[1]FF[4]CA[UTF-8]SZ[" << board::size_x << "]KM[0]";
+		ss << "PB[" << r.names[0] << "]PW[" << r.names[1] << "]";
+		ss << "RE[" << (r.winner == board::black ? 'B' : 'W') << '+' << r.reason << "]";
+		ss << "GC[time " << r.time[0] / 1000000.0 << "|" << r.time[1] / 1000000.0 << "]";
+		for (const action& move : game.actions()) ss << move;
+		if (r.reason == 'F') ss << r.fault << "C[illegal]";
+		ss << ")";
+		return ss.str();
+	}
+
+	/**
+	 * print the results in the form of run-gogui-twogtp.sh, with the games of the faults
+	 */
+	void summary(const std::vector<result>& results, double seconds) const {
+		size_t wins[2][2] = {}; // [P1 or P2][black or white]
+		std::string faults[2];  // the illegal moves and the timeouts
+		for (size_t k = 0; k < results.size(); k++) {
+			const result& r = results[k];
+			size_t p1 = k % 2, side = r.winner == board::black ? 0 : 1;
+			wins[side == 0 ? p1 : 1 - p1][side]++;
+			char loser = r.winner == board::black ? 'W' : 'B';
+			if (r.reason == 'F') faults[0] += std::string(" ") + loser + "#" + std::to_string(k);
+			if (r.reason == 'T') faults[1] += std::string(" ") + loser + "#" + std::to_string(k);
+		}
+		size_t total = std::max<size_t>(results.size(), 1);
+		std::cout << "P1: (" << wins[0][0] << "+" << wins[0][1] << ")/" << results.size() << " = "
+		          << (wins[0][0] + wins[0][1]) * 100.0 / total << "%" << std::endl;
+		std::cout << "P2: (" << wins[1][0] << "+" << wins[1][1] << ")/" << results.size() << " = "
+		          << (wins[1][0] + wins[1][1]) * 100.0 / total << "%" << std::endl;
+		if (faults[0].size()) std::cout << "> IA:" << faults[0] << std::endl;
+		if (faults[1].size()) std::cout << "> TLE:" << faults[1] << std::endl;
+		std::cout << results.size() << " games in " << seconds << " seconds, "
+		          << results.size() / std::max(seconds, 1e-9) << " games/s" << std::endl;
+	}
+
+private:
+	std::string spec[2];
+	size_t games;
+	size_t workers;
+	time_t limit; // the total thinking time of a side in a game, in milliseconds
+};
@@ -0,0 +1,283 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * mcts.h: Building blocks of the Monte-Carlo tree search
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include "board.h"
+#include "action.h"
+
+/**
+ * precomputed terms of the UCB1 exploration bonus, i.e.,
+ *   sqrt(log(parent) / child) == sqrt_log(parent) * inv_sqrt(child)
+ *
+ * counts beyond the table size fall back to the math library
+ */
+class uct_table {
+public:
+	enum { size = 1 << 16 };
+
+	static float sqrt_log(unsigned n) {
+		return n < size ? entries().sqrt_log[n] : std::sqrt(std::log(float(n)));
+	}
+	static float inv_sqrt(unsigned n) {
+		return n < size ? entries().inv_sqrt[n] : 1.0f / std::sqrt(float(n));
+	}
+
+private:
+	struct table {
+		float sqrt_log[size];
+		float inv_sqrt[size];
+		table() {
+			sqrt_log[0] = 0;
+			inv_sqrt[0] = 0;
+			for (unsigned n = 1; n < size; n++) {
+				sqrt_log[n] = std::sqrt(std::log(float(n)));
+				inv_sqrt[n] = 1.0f / std::sqrt(float(n));
+			}
+		}
+	};
+	static const table& entries() { static table t; return t; }
+};
+
+/**
+ * the search tree of MCTS, stored in a preallocated node pool
+ *
+ * a node is expanded by listing its legal moves into a preallocated move arena,
+ * while the child nodes are created lazily, one by one, when they are visited at the first time
+ * the board of a node is not stored but replayed from the root along the path,
+ * so that an iteration of the search never touches the heap
+ *
+ * nodes also carry proofs (MCTS-Solver), which are relative to the side to move at the root
+ * and are backed up from the terminal nodes by the minimax rules
+ */
+class mcts_tree {
+public:
+	enum proof_type { unknown = 0, win = 1, loss = -1 };
+	struct node {
+		int win_cnt;
+		int game_cnt;
+		uint32_t child;      // the index of the latest created child, or 0 if none
+		uint32_t sibling;    // the index of the next sibling, or 0 if none
+		uint32_t moves;      // the offset of the legal moves in the move arena
+		int16_t move;        // the 1-d position leading to this node, or -1 for the root
+		int8_t child_cnt;    // the number of created children
+		int8_t legal_cnt;    // the number of legal moves, or -1 if not expanded yet
+		int8_t proof;        // the proof_type of this node
+		board::piece_type w; // the side to move at this node
+
+		node(int move = -1, board::piece_type w = board::empty)
+			: win_cnt(0), game_cnt(0), child(0), sibling(0), moves(0), move(move), child_cnt(0), legal_cnt(-1), proof(unknown), w(w) {}
+		bool is_expanded() const { return legal_cnt >= 0; }
+	};
+	enum { max_depth = board::size_x * board::size_y + 1 };
+
+public:
+	mcts_tree(size_t capacity = 1 << 18) : pool(std::max<size_t>(capacity, 1)), used(0),
+		arena(pool.size() * 48), arena_used(0), depth(0) {}
+
+	/**
+	 * discard the whole tree and start from a new root
+	 */
+	void reset(const board& state, board::piece_type w) {
+		root_state = state;
+		pool[0] = node(-1, w);
+		used = 1;
+		arena_used = 0;
+		depth = 0;
+	}
+
+	node& root() { return pool[0]; }
+	const board& state() const { return root_state; }
+	node* child(const node& n) { return n.child ? &pool[n.child] : nullptr; }
+	node* sibling(const node& n) { return n.sibling ? &pool[n.sibling] : nullptr; }
+	const uint8_t* moves(const node& n) const { return &arena[n.moves]; }
+	size_t size() const { return used; }
+	size_t capacity() const { return pool.size(); }
+
+	/**
+	 * expand the node by listing its legal moves, following the given order
+	 * if the priors (indexed by 1-d position) are given, the moves are sorted by their priors in descending order
+	 * return false if the move arena runs out of space, the node is kept unexpanded in such case
+	 */
+	bool expand(node& n, const board& state, const std::vector<action::place>& order, const float* prior = nullptr) {
+		if (arena_used + order.size() > arena.size()) return false;
+		uint8_t* list = &arena[arena_used];
+		int8_t count = 0;
+		for (const action::place& move : order) {
+			board after = state;
+			if (move.apply(after) == board::legal) list[count++] = move.position().i;
+		}
+		for (int8_t i = 1; prior && i < count; i++) { // insertion sort, stable and allocation-free
+			uint8_t move = list[i];
+			int8_t j = i;
+			for (; j > 0 && prior[list[j - 1]] < prior[move]; j--) list[j] = list[j - 1];
+			list[j] = move;
+		}
+		n.moves = arena_used;
+		n.legal_cnt = count;
+		arena_used += count;
+		return true;
+	}
+
+	/**
+	 * create the child for the next unvisited legal move of an expanded node
+	 * return the new child, or nullptr if the pool runs out of nodes
+	 */
+	node* create(node& n) {
+		if (used >= pool.size() || n.child_cnt >= n.legal_cnt) return nullptr;
+		uint32_t index = used++;
+		pool[index] = node(moves(n)[n.child_cnt], static_cast<board::piece_type>(3u - n.w));
+		pool[index].sibling = n.child;
+		n.child = index;
+		n.child_cnt++;
+		return &pool[index];
+	}
+
+	/**
+	 * try to prove a node from its children by the minimax rules, i.e.,
+	 * the side to move wins if any child wins for it, and loses if all children lose for it
+	 * note that a node without legal moves is thereby a loss for its side to move
+	 * return true if the node is proven
+	 */
+	bool prove(node& n) {
+		if (n.proof != unknown) return true;
+		if (!n.is_expanded()) return false;
+		int8_t good = (n.w == root().w) ? win : loss;
+		bool all = (n.child_cnt == n.legal_cnt);
+		for (node* c = child(n); c; c = sibling(*c)) {
+			if (c->proof == good) {
+				n.proof = good;
+				return true;
+			}
+			if (c->proof != -good) all = false;
+		}
+		if (all) n.proof = -good;
+		return all;
+	}
+
+	/**
+	 * play the move of a child on the board without legality checks,
+	 * which is safe since only legal moves are expanded
+	 */
+	static void play(board& state, const node& child) {
+		board::point p(child.move);
+		state[p.x][p.y] = 3u - child.w;
+		state.info({child.w});
+	}
+
+	/**
+	 * the selection path of the current iteration, from the root to a leaf
+	 */
+	void clear_path() { depth = 0; }
+	void push_path(node* n) { path[depth++] = n; }
+	node** path_begin() { return path; }
+	node** path_end() { return path + depth; }
+
+private:
+	std::vector<node> pool;
+	size_t used;
+	std::vector<uint8_t> arena;
+	size_t arena_used;
+	board root_state;
+	node* path[max_depth];
+	size_t depth;
+};
+
+/**
+ * selection policies, which score a child from the view of its parent during the tree descent
+ * a child is scored from its statistics, the exploration term sqrt(log(parent visits)) of the parent,
+ * and the all-moves-as-first (AMAF) win rate and games of its move, both in the same view as the child statistics
+ * max_depth bounds the depth of the tree, beyond which the leaves are only simulated
+ */
+
+/**
+ * UCB1 on the child statistics
+ */
+struct uct_selection {
+	enum { max_depth = mcts_tree::max_depth, uses_amaf = 0 };
+	static float score(const mcts_tree::node& child, float sqrt_log, float amaf_rate, int amaf_games) {
+		if (child.game_cnt == 0) return 100000;
+		return float(child.win_cnt) / child.game_cnt + sqrt_log * uct_table::inv_sqrt(child.game_cnt);
+	}
+};
+
+/**
+ * RAVE, i.e., the child win rate blended with the AMAF win rate of its move by beta = sqrt(k / (3n + k)),
+ * which favors the AMAF statistics while the child has few visits n (k = 1000), plus the UCB1 exploration term
+ */
+struct rave_selection {
+	enum { max_depth = mcts_tree::max_depth, uses_amaf = 1 };
+	static float score(const mcts_tree::node& child, float sqrt_log, float amaf_rate, int amaf_games) {
+		if (child.game_cnt == 0 && amaf_games == 0) return 100000;
+		const float k = 1000;
+		float n = child.game_cnt;
+		float beta = std::sqrt(k / (3 * n + k));
+		float rate = n ? child.win_cnt / n : amaf_rate;
+		return (1 - beta) * rate + beta * amaf_rate + (n ? sqrt_log * uct_table::inv_sqrt(child.game_cnt) : 0);
+	}
+};
+
+/**
+ * flat Monte-Carlo, i.e., the moves of the root are sampled in turn without growing a tree below them
+ */
+struct flat_selection {
+	enum { max_depth = 1, uses_amaf = 0 };
+	static float score(const mcts_tree::node& child, float sqrt_log, float amaf_rate, int amaf_games) {
+		return -float(child.game_cnt);
+	}
+};
+
+/**
+ * playout policies, which finish the game from a leaf
+ */
+
+/**
+ * random playout, which plays the first legal move of the given move orders (shuffled by the caller) for each side
+ * every played move is passed to the record function for the AMAF statistics
+ * the playout is cut at 74 plies, and return the side without legal moves, or the opponent of who at the cut
+ */
+struct random_playout {
+	template<typename record>
+	static board::piece_type run(board& state, board::piece_type side, board::piece_type who,
+			const std::vector<action::place>& mine, const std::vector<action::place>& theirs, record played) {
+		for (int i = 1; i <= 74; i++, side = static_cast<board::piece_type>(3u - side)) {
+			const std::vector<action::place>& moves = (side == who) ? mine : theirs;
+			bool moved = false;
+			for (const action::place& move : moves) {
+				if (move.apply(state) == board::legal) { // the board is left unchanged if the move is illegal
+					played(move.position().i, side);
+					moved = true;
+					break;
+				}
+			}
+			if (!moved) return side;
+		}
+		return static_cast<board::piece_type>(3u - who);
+	}
+};
+
+/**
+ * backup policies, which decide the view of the statistics of a node
+ */
+
+/**
+ * all the nodes count the wins of the searching player, so that every node prefers the searching player
+ */
+struct player_backup {
+	static bool for_player(board::piece_type mover, board::piece_type who) { return true; }
+};
+
+/**
+ * a node counts the wins of the side who moved into it, so that every node prefers its side to move (negamax)
+ */
+struct negamax_backup {
+	static bool for_player(board::piece_type mover, board::piece_type who) { return mover == who; }
+};
@@ -11,22 +11,49 @@
 #include <fstream>
 #include <iterator>
 #include <string>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <atomic>
 #include "board.h"
 #include "action.h"
 #include "agent.h"
 #include "episode.h"
 #include "statistic.h"
+#include "archive.h"
+#include "analysis.h"
+#include "gtp.h"
+#include "server.h"
+#include "match.h"
+
+/**
+ * play a game between the agents until a side cannot move, and return the winner
+ */
+agent& play_episode(episode& game, agent& black, agent& white) {
+	while (true) {
+		agent& who = game.take_turns(black, white);
+		action move = who.take_action(game.state());
+		//std::cout << move << '\n';
+		if (game.apply_action(move, who.last_search()) != true) break;
+		if (who.check_for_win(game.state())) break;
+	}
+	return game.last_turns(black, white);
+}
 
 int main(int argc, const char* argv[]) {
 	std::cout << "HollowNoGo-Demo: ";
 	std::copy(argv, argv + argc, std::ostream_iterator<const char*>(std::cout, " "));
 	std::cout << std::endl << std::endl;
 
-	size_t total = 1000, block = 0, limit = 0;
+	size_t total = 1000, block = 0, limit = 0, parallel = 1, sessions = 0;
 	std::string black_args, white_args;
 	std::string load, save;
+	std::string analyze, analysis_args;
 	std::string name = "TCG-HollowNoGo-Demo", version = "2021"; // for GTP shell
-	bool summary = false, shell = false;
+	std::string serve; // the address of GTP server
+	std::string p1_args, p2_args, sgf; // for match
+	time_t timelimit = 300;
+	bool summary = false, shell = false, convert = false, match = false;
 	for (int i = 1; i < argc; i++) {
 		std::string para(argv[i]);
 		if (para.find("--total=") == 0) {
@@ -35,6 +62,8 @@ int main(int argc, const char* argv[]) {
 			block = std::stoull(para.substr(para.find("=") + 1));
 		} else if (para.find("--limit=") == 0) {
 			limit = std::stoull(para.substr(para.find("=") + 1));
+		} else if (para.find("--parallel=") == 0) {
+			parallel = std::max<size_t>(std::stoull(para.substr(para.find("=") + 1)), 1);
 		} else if (para.find("--black=") == 0) {
 			black_args = para.substr(para.find("=") + 1);
 		} else if (para.find("--white=") == 0) {
@@ -43,153 +72,143 @@ int main(int argc, const char* argv[]) {
 			load = para.substr(para.find("=") + 1);
 		} else if (para.find("--save=") == 0) {
 			save = para.substr(para.find("=") + 1);
+		} else if (para.find("--analyze=") == 0) {
+			analyze = para.substr(para.find("=") + 1);
+		} else if (para.find("--analysis=") == 0) {
+			analysis_args = para.substr(para.find("=") + 1);
 		} else if (para.find("--name=") == 0) {
 			name = para.substr(para.find("=") + 1);
 		} else if (para.find("--version=") == 0) {
 			version = para.substr(para.find("=") + 1);
 		} else if (para.find("--summary") == 0) {
 			summary = true;
+		} else if (para.find("--p1=") == 0) {
+			p1_args = para.substr(para.find("=") + 1);
+		} else if (para.find("--p2=") == 0) {
+			p2_args = para.substr(para.find("=") + 1);
+		} else if (para.find("--timelimit=") == 0) {
+			timelimit = std::stoll(para.substr(para.find("=") + 1));
+		} else if (para.find("--sgf=") == 0) {
+			sgf = para.substr(para.find("=") + 1);
+		} else if (para.find("--match") == 0) {
+			match = true;
+		} else if (para.find("--serve=") == 0) {
+			serve = para.substr(para.find("=") + 1);
+		} else if (para.find("--sessions=") == 0) {
+			sessions = std::stoull(para.substr(para.find("=") + 1));
 		} else if (para.find("--shell") == 0) {
 			shell = true;
+		} else if (para.find("--convert") == 0) {
+			convert = true;
 		}
 	}
 
+	if (convert) { // convert the episodes of a file between the text format and the binary format
+		bool complete = true;
+		long count = convert_episodes(load, save, &complete);
+		if (count < 0) std::cerr << "cannot convert " << load << " to " << save << std::endl;
+		else std::cout << count << " episodes converted from " << load << " to " << save << std::endl;
+		if (count >= 0 && !complete) std::cerr << "cannot convert all episodes of " << load << std::endl;
+		return count < 0 || !complete;
+	}
+
+	if (analyze.size()) { // re-analyze the saved games, see analysis.h
+		long count = game_analyzer(analysis_args).run(analyze);
+		if (count < 0) std::cerr << "cannot analyze " << analyze << std::endl;
+		else std::cout << count << " episodes analyzed" << std::endl;
+		return count < 0;
+	}
+
 	statistic stat(total, block, limit);
 
 	if (load.size()) {
-		std::ifstream in(load, std::ios::in);
-		in >> stat;
-		in.close();
+		if (!stat.load(load)) std::cerr << "cannot load all episodes of " << load << std::endl;
 		summary |= stat.is_finished();
 	}
 
-	//random_player black("name=black " + black_args + " role=black");
-	black_player black("name=black " + black_args + " role=black");
-	white_player white("name=white " + white_args + " role=white");
-	//random_player white("name=white " + white_args + " role=white");
-	//mtcs_uct_player black("name=black " + black_args + " role=black");
-	//mtcs_uct_player white("name=white " + white_args + " role=white");
-	//mtcs_uct_rave_player white("name=white " + white_args + " role=white");
-	//mtcs_with_sample_rave_player black("name=black " + black_args + " role=black");
-	//mtcs_with_sample_rave_player white("name=white " + white_args + " role=white");
-	//mtcs_uct_rave_player white("name=white " + white_args + " role=white");
-	//mtcs_with_sample_rave_player
-	if (!shell) { // launch standard local games
+	if (match) { // launch the match between P1 and P2 with swapped colors, see match.h
+		match_runner runner(p1_args, p2_args, stat.remaining(), parallel, timelimit * 1000);
+		if (!runner.run(stat, sgf)) {
+			std::cerr << "cannot write " << sgf << std::endl;
+			return 1;
+		}
+		if (summary) stat.summary();
+		if (save.size()) stat.save(save);
+		return 0;
+	}
+
+	if (serve.size()) { // launch GTP server of many sessions, see server.h
+		gtp_server server(black_args, white_args, name, version, parallel);
+		if (!server.listen(serve)) {
+			std::cerr << "cannot listen to " << serve << std::endl;
+			return 1;
+		}
+		std::cerr << "listening to " << serve << std::endl;
+		server.run(stat, sessions);
+		if (summary) stat.summary();
+		if (save.size()) stat.save(save);
+		return 0;
+	}
+
+	std::unique_ptr<agent> black_agent = make_player("name=black " + black_args + " role=black");
+	std::unique_ptr<agent> white_agent = make_player("name=white " + white_args + " role=white");
+	agent& black = *black_agent;
+	agent& white = *white_agent;
+	if (!shell && parallel > 1) { // launch local games in parallel
+		// every worker plays its own games with its own agents, where the first worker uses the agents above,
+		// and the agents of the other workers are seeded by the worker index (see seeded_args)
+		// the games are claimed by a counter, and the finished games are merged into the statistic in order,
+		// so that the statistic is the same as the one of the sequential games
+		size_t games = stat.remaining(), merged = 0;
+		std::atomic<size_t> next(0);
+		std::map<size_t, episode> finished; // the games waiting for the games before them
+		std::mutex merge;
+		auto work = [&](size_t id) {
+			std::unique_ptr<agent> black_own, white_own;
+			if (id) {
+				black_own = make_player(seeded_args("name=black " + black_args + " role=black", id));
+				white_own = make_player(seeded_args("name=white " + white_args + " role=white", id));
+			}
+			agent& black = id ? *black_own : *black_agent;
+			agent& white = id ? *white_own : *white_agent;
+			for (size_t k; (k = next++) < games; ) {
+				black.open_episode("~:" + white.name());
+				white.open_episode(black.name() + ":~");
+
+				episode game;
+				game.open_episode(black.name() + ":" + white.name());
+				agent& win = play_episode(game, black, white);
+				game.close_episode(win.name());
+				black.close_episode(win.name());
+				white.close_episode(win.name());
+
+				std::lock_guard<std::mutex> lock(merge);
+				finished.emplace(k, std::move(game));
+				for (auto it = finished.begin(); it != finished.end() && it->first == merged; it = finished.erase(it), merged++) {
+					stat.push_episode(std::move(it->second));
+					std::cout << "finish one game" << '\n';
+				}
+			}
+		};
+		std::vector<std::thread> workers;
+		for (size_t i = 1; i < std::min(parallel, games); i++) workers.emplace_back(work, i);
+		work(0);
+		for (std::thread& worker : workers) worker.join();
+	} else if (!shell) { // launch standard local games
 		while (!stat.is_finished()) {
 			black.open_episode("~:" + white.name());
 			white.open_episode(black.name() + ":~");
 
 			stat.open_episode(black.name() + ":" + white.name());
 			episode& game = stat.back();
-			while (true) {
-				agent& who = game.take_turns(black, white);
-				action move = who.take_action(game.state());
-				//std::cout << move << '\n';
-				if (game.apply_action(move) != true) break;
-				if (who.check_for_win(game.state())) break;
-			}
-			agent& win = game.last_turns(black, white);
+			agent& win = play_episode(game, black, white);
 			stat.close_episode(win.name());
 			std::cout << "finish one game" << '\n';
 			black.close_episode(win.name());
 			white.close_episode(win.name());
 		}
-	} else { // launch GTP shell
-		for (std::string command; std::getline(std::cin, command); ) {
-			if (command.back() == '\r') command.pop_back();
-			if (command.empty()) continue;
-
-			std::vector<std::string> args;
-			std::istringstream iss(command);
-			for (std::string s; getline(iss, s, ' '); args.push_back(s));
-
-			std::string reply;
-			if (args[0] == "play" || args[0] == "genmove") { // play a move, or generate a move and play
-				if (!stat.is_episode_ongoing()) { // should open an episode
-					black.open_episode("~:" + white.name());
-					white.open_episode(black.name() + ":~");
-					stat.open_episode(black.name() + ":" + white.name());
-				}
-
-				episode& game = stat.back();
-				agent& who = game.take_turns(black, white);
-				if (who.role()[0] != std::tolower(args[1][0])) { // player mismatch?!
-					std::cout << "= " << "resign" << std::endl << std::endl;
-					// show the error message and terminate the shell
-					std::cerr << "player color " << args[1] << " mismatch!" << std::endl;
-					std::cerr << "current state, "
-					          << who.role() << " to play: " << std::endl << game.state();
-					break;
-				}
-				if (args[0] == "play") { // play a move
-					std::string types = "?bw"; // black == 1, white == 2
-					action::place move(args[2], types.find(who.role()[0]));
-					if (game.apply_action(move) != true) { // remote plays an illegal move?!
-						std::cout << "= " << "resign" << std::endl << std::endl;
-						// show the error message and terminate the shell
-						std::cerr << who.role() << " plays an illegal action!" << std::endl;
-						const char* reason[] = {
-							"legal",
-							"illegal_turn",
-							"illegal_pass",
-							"illegal_out_of_range",
-							"illegal_not_empty",
-							"illegal_suicide",
-							"illegal_take",
-							"unknown",
-						};
-						std::cerr << "current state: " << std::endl << game.state();
-						int code = move.apply(game.state());
-						std::cerr << "action: " << args[1] << " " << args[2] << std::endl;
-						std::cerr << "reason: " << reason[std::min(-code, 7)] << std::endl;
-						break;
-					}
-				} else if (args[0] == "genmove") { // generate a move and play
-					action::place move = who.take_action(game.state());
-					if (game.apply_action(move) == true) {
-						reply = move.position();
-					} else { // I have no legal move to play
-						reply = "resign";
-					}
-				}
-
-			} else if (args[0] == "clear_board" || args[0] == "quit") { // reset game, or quit
-				if (stat.is_episode_ongoing()) { // should close an opened episode
-					agent& win = stat.back().last_turns(black, white);
-					stat.close_episode(win.name());
-					black.close_episode(win.name());
-					white.close_episode(win.name());
-				}
-				if (args[0] == "quit") break; // quit GTP shell
-
-			} else if (args[0] == "showboard") { // print the board
-				std::stringstream buf;
-				buf << (stat.is_episode_ongoing() ? stat.back().state() : board());
-				reply = "\n" + buf.str();
-				reply.pop_back(); // remove a new line
-
-			} else if (args[0] == "boardsize") { // set the board size
-				size_t size = std::stoul(args[1]);
-				if (size != board::size_x || size != board::size_y) {
-					std::cerr << "board size mismatch: " << args[1] << std::endl;
-				}
-				if (size > board::size_x || size > board::size_y) break;
-
-			} else if (args[0] == "name") { // report the name of the program
-				reply = name;
-			} else if (args[0] == "version") { // report the version number of the program
-				reply = version;
-			} else if (args[0] == "protocol_version") { // report GTP protocol version
-				reply = "2";
-			} else if (args[0] == "list_commands") { // print supported commands
-				reply = "play\n" "genmove\n" "clear_board\n" "showboard\n" "boardsize\n"
-				        "name\n" "version\n" "protocol_version\n" "list_commands\n" "quit\n";
-			} else {
-				reply = "unknown command";
-			}
-
-			std::cout << "= " << reply << std::endl << std::endl;
-		}
+	} else { // launch GTP shell, see gtp.h
+		gtp_shell(stat, black, white, name, version).run(std::cin, std::cout);
 	}
 
 	if (summary) {
@@ -197,9 +216,7 @@ int main(int argc, const char* argv[]) {
 	}
 
 	if (save.size()) {
-		std::ofstream out(save, std::ios::out | std::ios::trunc);
-		out << stat;
-		out.close();
+		stat.save(save);
 	}
 
 	return 0;
@@ -0,0 +1,191 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * server.h: Multi-session GTP server on a local socket
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "agent.h"
+#include "statistic.h"
+#include "gtp.h"
+
+/**
+ * a stream buffer of a connected socket, which is used for either reading or writing
+ * the writes never raise SIGPIPE, a closed peer fails the stream instead
+ */
+class socket_buffer : public std::streambuf {
+public:
+	socket_buffer(int fd) : fd(fd), buffer(1 << 12) {
+		setg(buffer.data(), buffer.data(), buffer.data());
+		setp(buffer.data(), buffer.data() + buffer.size());
+	}
+	~socket_buffer() { sync(); }
+
+protected:
+	virtual int_type underflow() {
+		ssize_t n;
+		while ((n = ::recv(fd, buffer.data(), buffer.size(), 0)) < 0 && errno == EINTR);
+		if (n <= 0) return traits_type::eof();
+		setg(buffer.data(), buffer.data(), buffer.data() + n);
+		return traits_type::to_int_type(*gptr());
+	}
+	virtual int_type overflow(int_type c) {
+		if (sync() != 0) return traits_type::eof();
+		if (!traits_type::eq_int_type(c, traits_type::eof())) sputc(traits_type::to_char_type(c));
+		return traits_type::not_eof(c);
+	}
+	virtual int sync() {
+		for (const char* p = pbase(); p < pptr(); ) {
+			ssize_t n = ::send(fd, p, pptr() - p, MSG_NOSIGNAL);
+			if (n < 0 && errno == EINTR) continue;
+			if (n <= 0) return setp(buffer.data(), buffer.data() + buffer.size()), -1;
+			p += n;
+		}
+		setp(buffer.data(), buffer.data() + buffer.size());
+		return 0;
+	}
+
+private:
+	int fd;
+	std::vector<char> buffer;
+};
+
+/**
+ * the GTP server of many concurrent sessions in a process, where every connection is a GTP session served by
+ * a gtp_shell with its own players, created by the same arguments as the players of the GTP shell
+ *
+ * the searches of all the sessions are run by a shared worker pool, so that at most "workers" searches run at once
+ * and the waiting searches are run in the order they are requested
+ * the read-only resources of the players are shared without copies, i.e., the opening book, the solved cache, and
+ * the endgame database are memory-mapped from the same files, and the tables of the selections are static
+ * the finished games of a session are appended to the statistic of the server when the session ends
+ *
+ * the address is "unix:path" for a Unix socket, or "[host:]port" for a TCP socket on 127.0.0.1 by default
+ */
+class gtp_server {
+public:
+	gtp_server(const std::string& black_args, const std::string& white_args,
+			const std::string& name, const std::string& version, size_t workers)
+		: black_args(black_args), white_args(white_args), name(name), version(version),
+		  pool(workers), listener(-1), active(0) {}
+	~gtp_server() { close(); }
+
+	/**
+	 * bind the address and listen to it, return false if the address is invalid or cannot be bound
+	 */
+	bool listen(const std::string& address) {
+		close();
+		if (address.find("unix:") == 0) {
+			sockaddr_un addr = {};
+			std::string path = address.substr(5);
+			if (path.empty() || path.size() >= sizeof(addr.sun_path)) return false;
+			addr.sun_family = AF_UNIX;
+			std::strcpy(addr.sun_path, path.c_str());
+			::unlink(path.c_str());
+			listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+			if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) return close(), false;
+			unlink_path = path;
+		} else {
+			sockaddr_in addr = {};
+			std::string host = address.find(':') != std::string::npos ? address.substr(0, address.find(':')) : "127.0.0.1";
+			std::string port = address.substr(address.find(':') + 1);
+			if (host == "localhost") host = "127.0.0.1";
+			addr.sin_family = AF_INET;
+			if (port.empty() || port.find_first_not_of("0123456789") != std::string::npos || std::stoul(port) > 65535) return false;
+			addr.sin_port = htons(std::stoul(port));
+			if (::inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) return false;
+			listener = ::socket(AF_INET, SOCK_STREAM, 0);
+			int reuse = 1;
+			if (listener >= 0) ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+			if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) return close(), false;
+		}
+		if (::listen(listener, 64) != 0) return close(), false;
+		return true;
+	}
+
+	/**
+	 * accept and serve the sessions, until the given number of sessions are served (0 for no limit)
+	 * return the number of served sessions
+	 */
+	size_t run(statistic& stat, size_t sessions = 0) {
+		size_t served = 0;
+		while (listener >= 0 && (sessions == 0 || served < sessions)) {
+			int fd = ::accept(listener, nullptr, nullptr);
+			if (fd < 0) {
+				if (errno == EINTR || errno == ECONNABORTED) continue;
+				break;
+			}
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				active++;
+			}
+			std::thread(&gtp_server::serve, this, fd, std::ref(stat)).detach();
+			served++;
+		}
+		std::unique_lock<std::mutex> guard(lock);
+		idle.wait(guard, [this]() { return active == 0; });
+		return served;
+	}
+
+	void close() {
+		if (listener >= 0) ::close(listener);
+		if (unlink_path.size()) ::unlink(unlink_path.c_str());
+		listener = -1;
+		unlink_path.clear();
+	}
+
+protected:
+	/**
+	 * serve a session until "quit", an error, or the end of the connection
+	 */
+	void serve(int fd, statistic& stat) {
+		{
+			statistic session(-1);
+			std::unique_ptr<agent> black = make_player("name=black " + black_args + " role=black");
+			std::unique_ptr<agent> white = make_player("name=white " + white_args + " role=white");
+			socket_buffer in_buffer(fd), out_buffer(fd);
+			std::istream in(&in_buffer);
+			std::ostream out(&out_buffer);
+			gtp_shell(session, *black, *white, name, version, &pool).run(in, out, [fd]() { ::shutdown(fd, SHUT_RD); });
+
+			std::lock_guard<std::mutex> guard(lock);
+			for (size_t i = 0; i < session.size(); i++) {
+				if (i + 1 == session.size() && session.is_episode_ongoing()) break;
+				stat.push_episode(std::move(session.at(i)));
+			}
+		}
+		::close(fd);
+		std::lock_guard<std::mutex> guard(lock);
+		if (--active == 0) idle.notify_all();
+	}
+
+private:
+	std::string black_args;
+	std::string white_args;
+	std::string name;
+	std::string version;
+	worker_pool pool;
+	int listener;
+	std::string unlink_path;
+	std::mutex lock;
+	std::condition_variable idle;
+	size_t active;
+};
@@ -0,0 +1,778 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * solver.h: Proof-number search for solving endgames
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include "board.h"
+#include "action.h"
+#include "cache.h"
+#include "endgame.h"
+#include "cancel.h"
+
+/**
+ * transposition table of solved positions, indexed by the zobrist hash
+ * the result is relative to the side to move of the position, with its winning move if any
+ */
+class solved_table {
+public:
+	enum result_type { unknown = 0, win = 1, loss = -1 };
+	struct entry {
+		uint64_t key;
+		int8_t result;
+		int8_t move;
+	};
+
+public:
+	solved_table(size_t size = 1 << 20) : table(size_t(1) << log2(size)), probes(0), hits(0) {}
+
+	int probe(uint64_t key, int* move = nullptr) {
+		const entry& e = table[key & (table.size() - 1)];
+		probes++;
+		if (e.key != key || e.result == unknown) return unknown;
+		hits++;
+		if (move) *move = e.move;
+		return e.result;
+	}
+	void store(uint64_t key, int result, int move = -1) {
+		entry& e = table[key & (table.size() - 1)];
+		e.key = key;
+		e.result = result;
+		e.move = move;
+	}
+	void clear() {
+		std::fill(table.begin(), table.end(), entry{0, unknown, -1});
+		probes = hits = 0;
+	}
+
+	size_t size() const { return table.size(); }
+	size_t probe_count() const { return probes; }
+	size_t hit_count() const { return hits; }
+
+private:
+	static unsigned log2(size_t size) {
+		unsigned n = 0;
+		while ((size_t(2) << n) <= size) n++;
+		return n;
+	}
+
+private:
+	std::vector<entry> table;
+	size_t probes;
+	size_t hits;
+};
+
+/**
+ * best-first proof-number search
+ *
+ * the root is an OR node for the side to move, and a position without legal moves is a loss for its side to move
+ * each iteration descends to the most-proving node, expands it with all its legal moves,
+ * and updates the proof and disproof numbers of its ancestors
+ * solved positions are kept in a transposition table, so that transpositions are solved at once
+ * the table is kept across searches until clear is called, so that the positions following a proven move
+ * (e.g., after the reply of the opponent) are usually solved at once without any search
+ * the search is bounded by the number of nodes and the time, see limit_nodes and limit_time, or stopped by stop
+ * a search stopped before the root is solved is resumed by solving the same position again, since the tree is kept
+ * until another position is solved, and the numbers of the root are usable meanwhile, see root_numbers
+ */
+class pn_solver {
+public:
+	enum result_type { unknown = solved_table::unknown, win = solved_table::win, loss = solved_table::loss };
+
+public:
+	pn_solver(size_t nodes = 1 << 20, time_t millisec = 5000, size_t table = 1 << 20)
+		: capacity(nodes), used(0), millisec(millisec), tt(table), expand_cnt(0), solved_move(-1), root_key(0) {}
+
+	void limit_nodes(size_t nodes) { capacity = std::max<size_t>(nodes, 1); }
+	void limit_time(time_t ms) { millisec = ms; }
+
+	/**
+	 * request the running search to stop as at the deadline, which may be called from another thread,
+	 * and the request holds until it is cleared by stop(false)
+	 */
+	void stop(bool flag = true) { token.cancel(flag); }
+
+	/**
+	 * solve the position for its side to move
+	 * return win or loss if solved, or unknown if the limits are reached first
+	 */
+	int solve(const board& state) {
+		bool resumed = pool.size() == capacity && used > 1 && root_key == state.hash() && pool[0].pn && pool[0].dn;
+		if (pool.size() != capacity) pool.assign(capacity, node()); // allocated at the first use
+		solved_move = -1;
+		root_key = state.hash();
+		int result = tt.probe(root_key, &solved_move);
+		if (result != unknown || !resumed) {
+			expand_cnt = 0;
+			used = 1;
+			pool[0] = node();
+		}
+		if (result != unknown) { // solved by a previous search
+			assign(pool[0], result, true);
+			pool[0].expanded = true;
+			return result;
+		}
+		token.expire_after(std::max<time_t>(millisec, 1));
+
+		for (size_t iter = 0; pool[0].pn && pool[0].dn; iter++) {
+			if (token.poll(iter)) break;
+
+			// select the most-proving node
+			board b = state;
+			size_t depth = 0;
+			path[0] = 0;
+			keys[0] = state.hash();
+			while (pool[path[depth]].expanded) {
+				const node& n = pool[path[depth]];
+				bool is_or = (depth % 2 == 0);
+				uint32_t best = n.child;
+				for (uint32_t c = n.child; c < n.child + n.child_cnt; c++) {
+					if (is_or ? pool[c].pn < pool[best].pn : pool[c].dn < pool[best].dn) best = c;
+				}
+				unsigned who = b.info().who_take_turns;
+				board::point p(pool[best].move);
+				b[p.x][p.y] = who;
+				b.info({static_cast<board::piece_type>(3u - who)});
+				keys[depth + 1] = keys[depth] ^ board::zobrist(p.i, who) ^ board::zobrist_turn();
+				path[++depth] = best;
+			}
+
+			// expand it, and update its ancestors
+			if (!expand(path[depth], b, keys[depth], depth % 2 == 0)) break; // out of nodes
+			for (size_t d = depth + 1; d-- > 0; ) update(path[d], keys[d], d % 2 == 0);
+		}
+
+		if (pool[0].pn == 0) return win;
+		if (pool[0].dn == 0) return loss;
+		return unknown;
+	}
+
+	/**
+	 * the root move proven to win, or -1 if none
+	 */
+	int proven_move() const {
+		if (pool.empty()) return -1;
+		const node& root = pool[0];
+		if (root.pn == 0 && root.child_cnt == 0) return solved_move;
+		for (uint32_t c = root.child; c < root.child + root.child_cnt; c++) {
+			if (pool[c].pn == 0) return pool[c].move;
+		}
+		return -1;
+	}
+
+	/**
+	 * the root move with the smallest proof number, or -1 if the root is not expanded or has no legal move
+	 */
+	int promising_move() const {
+		if (pool.empty()) return -1;
+		const node& root = pool[0];
+		int move = -1;
+		uint32_t pn = infinity + 1;
+		for (uint32_t c = root.child; c < root.child + root.child_cnt; c++) {
+			if (pool[c].pn < pn) {
+				pn = pool[c].pn;
+				move = pool[c].move;
+			}
+		}
+		return move;
+	}
+
+	/**
+	 * the proof and disproof numbers of the root, which are partial if the search is stopped before solving it
+	 */
+	void root_numbers(uint32_t& pn, uint32_t& dn) const {
+		pn = pool.size() ? pool[0].pn : 1;
+		dn = pool.size() ? pool[0].dn : 1;
+	}
+
+	/**
+	 * forget all the solved positions, e.g., at the beginning of a new game
+	 */
+	void clear() {
+		tt.clear();
+		root_key = 0;
+	}
+
+	size_t node_count() const { return used; }
+	size_t expand_count() const { return expand_cnt; }
+	const solved_table& table() const { return tt; }
+
+private:
+	static const uint32_t infinity = 1u << 28;
+	enum { max_depth = board::size_x * board::size_y + 2 };
+
+	struct node {
+		uint32_t pn;
+		uint32_t dn;
+		uint32_t child;    // the index of the first child in the pool
+		uint8_t child_cnt; // the number of children
+		int8_t move;       // the 1-d position leading to this node
+		bool expanded;
+		node(int move = -1) : pn(1), dn(1), child(0), child_cnt(0), move(move), expanded(false) {}
+	};
+
+	/**
+	 * set the numbers of a node from the result of its side to move
+	 */
+	static void assign(node& n, int result, bool is_or) {
+		bool proven = (result == win) == is_or;
+		n.pn = proven ? 0 : infinity;
+		n.dn = proven ? infinity : 0;
+	}
+
+	/**
+	 * expand a node with all its legal moves, the children already solved in the table are solved at once
+	 * return false if the pool runs out of nodes
+	 */
+	bool expand(uint32_t index, const board& b, uint64_t key, bool is_or) {
+		int result = tt.probe(key);
+		if (result != unknown) {
+			assign(pool[index], result, is_or);
+			pool[index].expanded = true;
+			return true;
+		}
+
+		unsigned who = b.info().who_take_turns;
+		int8_t moves[board::size_x * board::size_y];
+		size_t count = 0;
+		for (int i = 0; i < board::size_x * board::size_y; i++) {
+			board after = b;
+			if (action::place(i, who).apply(after) == board::legal) moves[count++] = i;
+		}
+		if (used + count > pool.size()) return false;
+
+		node& n = pool[index];
+		n.expanded = true;
+		n.child = used;
+		n.child_cnt = count;
+		expand_cnt++;
+		for (size_t k = 0; k < count; k++) {
+			node& c = pool[used++];
+			c = node(moves[k]);
+			int solved = tt.probe(key ^ board::zobrist(moves[k], who) ^ board::zobrist_turn());
+			if (solved != unknown) assign(c, solved, !is_or);
+		}
+		if (count == 0) { // no legal move, the side to move loses
+			assign(n, loss, is_or);
+			tt.store(key, loss);
+		}
+		return true;
+	}
+
+	/**
+	 * recompute the numbers of an expanded node from its children, and record it into the table once solved
+	 */
+	void update(uint32_t index, uint64_t key, bool is_or) {
+		node& n = pool[index];
+		if (n.child_cnt == 0 || n.pn == 0 || n.dn == 0) return;
+		uint32_t min = infinity, sum = 0;
+		int decisive = -1;
+		for (uint32_t c = n.child; c < n.child + n.child_cnt; c++) {
+			uint32_t minor = is_or ? pool[c].pn : pool[c].dn;
+			uint32_t major = is_or ? pool[c].dn : pool[c].pn;
+			if (minor < min) min = minor;
+			if (minor == 0 && decisive == -1) decisive = pool[c].move;
+			sum = std::min(sum + major, infinity);
+		}
+		n.pn = is_or ? min : sum;
+		n.dn = is_or ? sum : min;
+		if (n.pn == 0) tt.store(key, is_or ? win : loss, is_or ? decisive : -1);
+		if (n.dn == 0) tt.store(key, is_or ? loss : win, is_or ? -1 : decisive);
+	}
+
+private:
+	std::vector<node> pool;
+	size_t capacity;
+	size_t used;
+	time_t millisec;
+	solved_table tt;
+	size_t expand_cnt;
+	int solved_move; // the winning move of a root solved by the table
+	uint64_t root_key;
+	cancel_token token;
+	uint32_t path[max_depth];
+	uint64_t keys[max_depth];
+};
+
+/**
+ * depth-first proof-number search (df-pn) with 1+epsilon thresholds
+ *
+ * the numbers are in negamax form, i.e., pn proves and dn disproves a win of the side to move,
+ * so that pn(n) = min dn(child) and dn(n) = sum pn(child), and a position without legal moves has pn = inf, dn = 0
+ * the proof tree is never materialized, all the numbers live in a fixed-size transposition table,
+ * therefore the memory is bounded by the table size no matter how long the search runs
+ * the table is kept across searches until clear is called, so that the next search starts from the
+ * proven and partially proven positions of the previous one, i.e., a stopped search (see stop) is resumed
+ * by solving the same position again, and the numbers of the root are usable meanwhile, see root_numbers
+ *
+ * with multiple threads, all threads search from the root and share the table, which is guarded by striped locks
+ * a node being searched is marked busy, and its disproof number is virtually inflated when its parent selects a child,
+ * so that the threads spread over different most-proving nodes
+ */
+class dfpn_solver {
+public:
+	enum result_type { unknown = solved_table::unknown, win = solved_table::win, loss = solved_table::loss };
+
+public:
+	dfpn_solver(size_t entries = 1 << 20, time_t millisec = 5000, float epsilon = 0.25)
+		: entries(entries), millisec(millisec), nodes(0), epsilon(epsilon), threads(1),
+		  node_cnt(0), probes(0), hits(0), elapsed(0), halted(false), node_total(0) {}
+
+	void limit_memory(size_t bytes) { entries = std::max<size_t>(bytes / sizeof(entry), bucket); table.clear(); }
+	void limit_nodes(size_t n) { nodes = n; }
+	void limit_time(time_t ms) { millisec = ms; }
+	void set_epsilon(float e) { epsilon = e; }
+	void set_threads(size_t n) { threads = std::max<size_t>(n, 1); }
+
+	/**
+	 * request the running search to stop as at the deadline, which may be called from another thread,
+	 * and the request holds until it is cleared by stop(false)
+	 */
+	void stop(bool flag = true) { token.cancel(flag); }
+
+	/**
+	 * solve the position for its side to move
+	 * return win or loss if solved, or unknown if the limits are reached first
+	 */
+	int solve(const board& state) {
+		if (table.empty()) table.resize(size_t(1) << log2(entries));
+		halted = false;
+		node_total = 0;
+		start = std::chrono::steady_clock::now();
+		token.expire_at(start + std::chrono::milliseconds(std::max<time_t>(millisec, 1)));
+		root = state;
+		root_key = state.hash();
+
+		std::vector<worker> workers(threads);
+		std::vector<std::thread> helpers;
+		for (size_t i = 1; i < threads; i++) helpers.emplace_back(&dfpn_solver::run, this, std::ref(workers[i]));
+		run(workers[0]);
+		for (std::thread& helper : helpers) helper.join();
+		elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		node_cnt = probes = hits = 0;
+		for (const worker& w : workers) {
+			node_cnt += w.nodes;
+			probes += w.probes;
+			hits += w.hits;
+		}
+
+		uint32_t pn, dn, busy;
+		numbers(workers[0], root_key, pn, dn, busy);
+		if (pn == 0) return win;
+		if (dn == 0) return loss;
+		return unknown;
+	}
+
+	/**
+	 * the root move proven to win, or -1 if none
+	 */
+	int proven_move() {
+		int move = -1;
+		uint32_t dn = 1;
+		best_child(move, dn);
+		return dn == 0 ? move : -1;
+	}
+
+	/**
+	 * the root move most likely to win (with the smallest disproof number of the child), or -1 if no legal move
+	 */
+	int promising_move() {
+		int move = -1;
+		uint32_t dn = 0;
+		best_child(move, dn);
+		return move;
+	}
+
+	/**
+	 * the proof and disproof numbers of the root, which are partial if the search is stopped before solving it
+	 */
+	void root_numbers(uint32_t& pn, uint32_t& dn) {
+		uint32_t busy;
+		worker w;
+		if (table.empty()) pn = dn = 1;
+		else numbers(w, root_key, pn, dn, busy);
+	}
+
+	/**
+	 * forget all the positions, e.g., at the beginning of a new game
+	 */
+	void clear() { std::fill(table.begin(), table.end(), entry()); }
+
+	size_t node_count() const { return node_cnt; }
+	double seconds() const { return elapsed; }
+	double nodes_per_sec() const { return elapsed > 0 ? node_cnt / elapsed : 0; }
+	double hit_rate() const { return probes ? hits * 1.0 / probes : 0; }
+	size_t memory() const { return (size_t(1) << log2(entries)) * sizeof(entry); }
+
+private:
+	static const uint32_t infinity = 1u << 28;
+	enum { bucket = 4, stripes = 4096 };
+
+	struct entry {
+		uint64_t key;
+		uint32_t pn;
+		uint32_t dn;
+		uint32_t work; // the number of nodes searched below, for the replacement scheme
+		uint32_t busy; // the number of threads searching this node
+		entry() : key(0), pn(1), dn(1), work(0), busy(0) {}
+	};
+
+	/**
+	 * the counters of a searching thread
+	 */
+	struct worker {
+		size_t nodes;
+		size_t probes;
+		size_t hits;
+		worker() : nodes(0), probes(0), hits(0) {}
+	};
+
+	/**
+	 * the lock of the stripe of a bucket, which is only taken when multiple threads are searching
+	 */
+	class guard {
+	public:
+		guard(std::mutex* m) : m(m) { if (m) m->lock(); }
+		~guard() { if (m) m->unlock(); }
+	private:
+		std::mutex* m;
+	};
+
+	static unsigned log2(size_t size) {
+		unsigned n = 0;
+		while ((size_t(2) << n) <= size) n++;
+		return n;
+	}
+
+	entry* bucket_of(uint64_t key) { return &table[key & (table.size() - bucket)]; }
+	std::mutex* stripe_of(uint64_t key) { return threads > 1 ? &locks[(key / bucket) % stripes] : nullptr; }
+
+	/**
+	 * the numbers of a position, which are (1, 1) if it is not in the table
+	 */
+	void numbers(worker& w, uint64_t key, uint32_t& pn, uint32_t& dn, uint32_t& busy) {
+		guard lock(stripe_of(key));
+		entry* b = bucket_of(key);
+		w.probes++;
+		for (size_t i = 0; i < bucket; i++) {
+			if (b[i].key == key) {
+				w.hits++;
+				pn = b[i].pn;
+				dn = b[i].dn;
+				busy = b[i].busy;
+				return;
+			}
+		}
+		pn = dn = 1;
+		busy = 0;
+	}
+
+	/**
+	 * the entry of a position, replacing the entry with the least work in the bucket if not found
+	 * solved and busy positions are preferred to stay, the stripe should be locked by the caller
+	 */
+	entry& slot(uint64_t key) {
+		entry* b = bucket_of(key);
+		entry* victim = &b[0];
+		for (size_t i = 0; i < bucket; i++) {
+			if (b[i].key == key) return b[i];
+			if (priority(b[i]) < priority(*victim)) victim = &b[i];
+		}
+		*victim = entry();
+		victim->key = key;
+		return *victim;
+	}
+	static uint64_t priority(const entry& e) {
+		if (e.key == 0) return 0;
+		if (e.pn == 0 || e.dn == 0) return uint64_t(-1);
+		return e.work + (uint64_t(e.busy) << 32);
+	}
+
+	void store(uint64_t key, uint32_t pn, uint32_t dn, uint32_t work) {
+		guard lock(stripe_of(key));
+		entry& e = slot(key);
+		e.pn = pn;
+		e.dn = dn;
+		e.work = work;
+	}
+	void enter(uint64_t key) {
+		if (threads == 1) return;
+		guard lock(stripe_of(key));
+		slot(key).busy++;
+	}
+	void leave(uint64_t key) {
+		if (threads == 1) return;
+		guard lock(stripe_of(key));
+		entry& e = slot(key);
+		if (e.busy) e.busy--;
+	}
+
+	/**
+	 * the main loop of a thread, which searches from the root until it is solved or the limits are reached
+	 */
+	void run(worker& w) {
+		while (!halted) {
+			mid(w, root, root_key, infinity, infinity);
+			uint32_t pn, dn, busy;
+			numbers(w, root_key, pn, dn, busy);
+			if (pn == 0 || dn == 0) halted = true;
+		}
+	}
+
+	/**
+	 * multiple iterative deepening at a node, until its numbers exceed the thresholds
+	 */
+	void mid(worker& w, const board& b, uint64_t key, uint32_t thpn, uint32_t thdn) {
+		if ((++w.nodes & 0x3ff) == 0 && nodes && (node_total += 0x400) >= nodes) halted = true;
+		if (token.poll(w.nodes)) halted = true;
+		if (halted) return;
+
+		unsigned who = b.info().who_take_turns;
+		int8_t moves[board::size_x * board::size_y];
+		uint64_t keys[board::size_x * board::size_y];
+		size_t count = 0;
+		for (int i = 0; i < board::size_x * board::size_y; i++) {
+			board after = b;
+			if (action::place(i, who).apply(after) == board::legal) {
+				moves[count] = i;
+				keys[count++] = key ^ board::zobrist(i, who) ^ board::zobrist_turn();
+			}
+		}
+		if (count == 0) { // no legal move, the side to move loses
+			store(key, infinity, 0, 1);
+			return;
+		}
+
+		size_t begin = w.nodes;
+		enter(key);
+		while (true) {
+			uint32_t pn = infinity, dn = 0, dn2 = infinity, pn1 = 1, dn1 = infinity;
+			uint64_t selected = uint64_t(-1);
+			size_t best = 0;
+			for (size_t k = 0; k < count; k++) {
+				uint32_t cpn, cdn, busy;
+				numbers(w, keys[k], cpn, cdn, busy);
+				dn = std::min(dn + cpn, infinity);
+				pn = std::min(pn, cdn);
+				uint64_t virtual_dn = uint64_t(cdn) * (1 + busy); // steer away from the nodes searched by others
+				if (virtual_dn < selected) {
+					if (selected != uint64_t(-1)) dn2 = std::min(dn2, dn1);
+					selected = virtual_dn;
+					dn1 = cdn;
+					pn1 = cpn;
+					best = k;
+				} else {
+					dn2 = std::min(dn2, cdn);
+				}
+			}
+			store(key, pn, dn, w.nodes - begin);
+			if (pn >= thpn || dn >= thdn || pn == 0 || dn == 0 || halted) break;
+
+			uint32_t child_thpn = std::min<uint64_t>(uint64_t(thdn) - dn + pn1, infinity);
+			uint32_t child_thdn = std::min<uint64_t>(thpn, std::max<uint64_t>(dn2 + 1, uint64_t(dn2 * (1 + epsilon))));
+			child_thdn = std::max(child_thdn, dn1 + 1); // the selected child may not be the best under virtual numbers
+			board after = b;
+			board::point p(moves[best]);
+			after[p.x][p.y] = who;
+			after.info({static_cast<board::piece_type>(3u - who)});
+			mid(w, after, keys[best], child_thpn, child_thdn);
+		}
+		leave(key);
+	}
+
+	/**
+	 * find the root child with the smallest disproof number
+	 */
+	void best_child(int& move, uint32_t& dn) {
+		if (table.empty()) return;
+		worker w;
+		unsigned who = root.info().who_take_turns;
+		uint32_t best = infinity + 1;
+		for (int i = 0; i < board::size_x * board::size_y; i++) {
+			board after = root;
+			if (action::place(i, who).apply(after) != board::legal) continue;
+			uint32_t cpn, cdn, busy;
+			numbers(w, root_key ^ board::zobrist(i, who) ^ board::zobrist_turn(), cpn, cdn, busy);
+			if (cdn < best) {
+				best = cdn;
+				move = i;
+			}
+		}
+		dn = best;
+	}
+
+private:
+	std::vector<entry> table;
+	std::mutex locks[stripes];
+	size_t entries;
+	time_t millisec;
+	size_t nodes;
+	float epsilon;
+	size_t threads;
+	board root;
+	uint64_t root_key;
+
+	size_t node_cnt;
+	size_t probes;
+	size_t hits;
+	double elapsed;
+	std::atomic<bool> halted;
+	std::atomic<size_t> node_total;
+	std::chrono::steady_clock::time_point start;
+	cancel_token token;
+};
+
+/**
+ * the endgame solver of the agents, which is configured by the agent arguments
+ *   "solver=pns" (default) or "solver=dfpn" selects the engine
+ *   "pn_nodes=N" and "pn_time=ms" limit the search, and "pn_memory=MB" bounds the table of df-pn
+ *   "threads=N" runs df-pn with N threads, which is then used unless "solver=pns" is given
+ *   "cache=path" shares the solved positions with other processes and games by a file, see solved_cache,
+ *   which is created with "cache_size=N" slots and is consulted before any search
+ *   "endgame=path" probes the endgame database generated offline (see endgame.cpp) before any search
+ */
+class endgame_solver {
+public:
+	enum { enabled = 1 };
+
+public:
+	endgame_solver() : use_dfpn(false), cached(solved_cache::unknown), cached_move(-1) {}
+
+	template<typename options>
+	void configure(options& meta) {
+		if (meta.find("solver") != meta.end()) use_dfpn = (std::string(meta["solver"]) == "dfpn");
+		if (meta.find("pn_nodes") != meta.end()) {
+			pns.limit_nodes(size_t(meta["pn_nodes"]));
+			dfpn.limit_nodes(size_t(meta["pn_nodes"]));
+		}
+		if (meta.find("pn_time") != meta.end()) {
+			pns.limit_time(time_t(meta["pn_time"]));
+			dfpn.limit_time(time_t(meta["pn_time"]));
+		}
+		if (meta.find("pn_memory") != meta.end()) dfpn.limit_memory(size_t(meta["pn_memory"]) << 20);
+		if (meta.find("threads") != meta.end()) {
+			dfpn.set_threads(size_t(meta["threads"]));
+			use_dfpn = (meta.find("solver") == meta.end()) || use_dfpn;
+		}
+		if (meta.find("cache") != meta.end()) {
+			size_t size = meta.find("cache_size") != meta.end() ? size_t(meta["cache_size"]) : (1 << 22);
+			cache.open(std::string(meta["cache"]), size);
+		}
+		if (meta.find("endgame") != meta.end()) database.open(std::string(meta["endgame"]));
+	}
+
+	/**
+	 * the winning move of a position recorded in the cache, or -1 if the position is not recorded as a win
+	 */
+	int lookup(const board& state) const {
+		if (!cache.is_open() && !database.is_open()) return -1;
+		unsigned symmetry;
+		uint64_t key = state.canonical_hash(&symmetry);
+		int move = -1;
+		return recorded(key, symmetry, move) == solved_cache::win ? move : -1;
+	}
+
+	/**
+	 * solve the position for its side to move, unless it is recorded in the cache or the endgame database
+	 * a position solved by the search is then recorded into the cache
+	 */
+	int solve(const board& state) {
+		root = state;
+		unsigned symmetry = 0;
+		uint64_t key = cache.is_open() || database.is_open() ? state.canonical_hash(&symmetry) : 0;
+		cached = key ? recorded(key, symmetry, cached_move) : solved_cache::unknown;
+		if (cached != solved_cache::unknown) return cached;
+		int result = use_dfpn ? dfpn.solve(state) : pns.solve(state);
+		if (result != solved_cache::unknown && cache.is_open()) {
+			int move = proven_move();
+			cache.store(key, result, move >= 0 ? board::symmetric(move, symmetry) : -1);
+		}
+		return result;
+	}
+	int proven_move() {
+		if (cached != solved_cache::unknown) return cached == solved_cache::win ? cached_move : -1;
+		return use_dfpn ? dfpn.proven_move() : pns.proven_move();
+	}
+	int promising_move() {
+		if (cached == solved_cache::win) return cached_move;
+		if (cached == solved_cache::loss) { // any legal move, since all of them lose
+			for (int i = 0; i < board::size_x * board::size_y; i++) {
+				board after = root;
+				if (action::place(i, root.info().who_take_turns).apply(after) == board::legal) return i;
+			}
+			return -1;
+		}
+		return use_dfpn ? dfpn.promising_move() : pns.promising_move();
+	}
+	size_t node_count() const { return use_dfpn ? dfpn.node_count() : pns.node_count(); }
+	void root_numbers(uint32_t& pn, uint32_t& dn) {
+		if (cached != solved_cache::unknown) { // in the scale of the engines, where 1 << 28 is the infinity
+			pn = cached == solved_cache::win ? 0 : 1u << 28;
+			dn = cached == solved_cache::win ? 1u << 28 : 0;
+		} else if (use_dfpn) dfpn.root_numbers(pn, dn);
+		else pns.root_numbers(pn, dn);
+	}
+	void stop(bool flag = true) {
+		pns.stop(flag);
+		dfpn.stop(flag);
+	}
+	void clear() {
+		pns.clear();
+		dfpn.clear();
+	}
+
+private:
+	/**
+	 * the result of a position recorded in the cache or the endgame database,
+	 * with its winning move mapped back from the canonical symmetry (-1 if none)
+	 */
+	int recorded(uint64_t key, unsigned symmetry, int& move) const {
+		int result = cache.probe(key, &move);
+		if (result == solved_cache::unknown) result = database.probe(key, &move);
+		if (result == solved_cache::unknown) move = -1;
+		if (move >= 0) move = board::asymmetric(move, symmetry);
+		return result;
+	}
+
+private:
+	pn_solver pns;
+	dfpn_solver dfpn;
+	bool use_dfpn;
+	solved_cache cache;
+	endgame_db database;
+	board root;
+	int cached;      // the result of the last solved position if it is from the cache
+	int cached_move; // and its winning move
+};
+
+/**
+ * the stand-in of endgame_solver for the players without the endgame phase, which solves nothing
+ */
+class no_solver {
+public:
+	enum { enabled = 0 };
+
+public:
+	template<typename options>
+	void configure(options& meta) {}
+	int lookup(const board& state) const { return -1; }
+	int solve(const board& state) { return solved_cache::unknown; }
+	int proven_move() { return -1; }
+	int promising_move() { return -1; }
+	size_t node_count() const { return 0; }
+	void stop(bool flag = true) {}
+	void clear() {}
+};
@@ -8,14 +8,24 @@
  */
 
 #pragma once
-#include <list>
+#include <deque>
+#include <vector>
+#include <cstdint>
 #include <algorithm>
 #include <iostream>
 #include <sstream>
+#include <fstream>
+#include <thread>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "board.h"
 #include "action.h"
 #include "agent.h"
 #include "episode.h"
+#include "archive.h"
 
 class statistic {
 public:
@@ -30,14 +40,14 @@ public:
 		: total(total),
 		  block(block ? block : total),
 		  limit(limit ? limit : total),
-		  count(0) {}
+		  count(0), window(), overall() {}
 
 public:
 	/**
 	 * show the statistic of last 'block' games
 	 *
 	 * the format would be
-	 * 1000   win = 53.5%|46.5%, op = 74.451 (37.493|36.958), ops = 125762 (132018|135377)
+	 * 1000   win = 53.5%|46.5%, op = 74.451 (37.493|36.958), ops = 125762 (132018|135377), pps = 52135 (51003|0)
 	 *
 	 * where (block = 1000 by default)
 	 *  '1000': current index (n), i.e., this line is the statistic of game 1 ~ 1000
@@ -48,48 +58,31 @@ public:
 	 *  'ops = 125762 (132018|135377)': the average speed is 125762
 	 *                                  the average speed of black is 132018
 	 *                                  the average speed of white is 135377
+	 *  'pps = 52135 (51003|0)': the playouts per second of the searches, which is shown if there is any playout
+	 *                           the playouts per second of black is 51003
+	 *                           the playouts per second of white is 0
+	 *
+	 * the speeds are measured by the thinking time of the moves
 	 */
 	void show() const {
-		size_t blk = std::min(data.size(), block);
-		size_t sop = 0, Bop = 0, Wop = 0;
-		time_t sdu = 0, Bdu = 0, Wdu = 0;
-		size_t BW = 0, WW = 0;
-		auto it = data.end();
-		for (size_t i = 0; i < blk; i++) {
-			auto& ep = *(--it);
-			if (ep.ep_moves.size() % 2 == 1) BW++;
-			else                             WW++;
-			sop += ep.step();
-			Bop += ep.step(action::black::type);
-			Wop += ep.step(action::white::type);
-			sdu += ep.time();
-			Bdu += ep.time(action::black::type);
-			Wdu += ep.time(action::white::type);
-		}
-
-		std::cout << count << "\t";
-		std::cout << "win = " << (BW * 100.0 / blk) << "%"
-		          <<      "|" << (WW * 100.0 / blk) << "%, ";
-		std::cout << "op = "  << (sop * 1.0 / blk)
-		          <<     " (" << (Bop * 1.0 / blk)
-		          <<      "|" << (Wop * 1.0 / blk) << "), ";
-		std::cout << "ops = " << (sop * 1000.0 / sdu)
-		          <<     " (" << (Bop * 1000.0 / Bdu)
-		          <<      "|" << (Wop * 1000.0 / Wdu) << ")";
-		std::cout << std::endl;
+		show(window);
 	}
 
+	/**
+	 * show the statistic of all the games, in the same format as show()
+	 */
 	void summary() const {
-		auto block_temp = block;
-		const_cast<statistic&>(*this).block = data.size();
-		show();
-		const_cast<statistic&>(*this).block = block_temp;
+		show(overall);
 	}
 
 	bool is_finished() const {
 		return count >= total;
 	}
 
+	size_t remaining() const {
+		return total > count ? total - count : 0;
+	}
+
 	bool is_episode_ongoing() const {
 		return data.size() && data.back().ep_close.when == 0;
 	}
@@ -102,13 +95,28 @@ public:
 
 	void close_episode(const std::string& flag = "") {
 		data.back().close_episode(flag);
+		accumulate(data.back());
+		if (count % block == 0) show();
+	}
+
+	/**
+	 * append an episode which is already closed, e.g., a game played by another thread
+	 */
+	void push_episode(episode&& ep) {
+		if (count++ >= limit) data.pop_front();
+		data.push_back(std::move(ep));
+		accumulate(data.back());
 		if (count % block == 0) show();
 	}
 
+	/**
+	 * the number of the recorded episodes, which is at most the limit
+	 */
+	size_t size() const {
+		return data.size();
+	}
 	episode& at(size_t i) {
-		auto it = data.begin();
-		while (i--) it++;
-		return *it;
+		return data[i];
 	}
 	episode& front() {
 		return data.front();
@@ -124,17 +132,218 @@ public:
 	friend std::istream& operator >>(std::istream& in, statistic& stat) {
 		for (std::string line; std::getline(in, line) && line.size(); ) {
 			stat.data.emplace_back();
-			std::stringstream(line) >> stat.data.back();
+			if (!(std::stringstream(line) >> stat.data.back())) { // the episodes end at a line which is not an episode
+				stat.data.pop_back();
+				in.setstate(std::ios::failbit);
+				break;
+			}
 		}
 		stat.total = std::max(stat.total, stat.data.size());
 		stat.count = stat.data.size();
+		stat.rebuild();
 		return in;
 	}
 
+	/**
+	 * save the episodes to a file, in the binary format (see archive.h) if its name ends with ".bin",
+	 * or in the text format otherwise
+	 */
+	bool save(const std::string& path) const {
+		if (episode_archive::binary_name(path)) {
+			episode_writer out;
+			if (!out.open(path)) return false;
+			for (const episode& rec : data) out.write(rec);
+			return out.close();
+		}
+		std::ofstream out(path, std::ios::out | std::ios::trunc);
+		return out << *this && out.flush();
+	}
+
+	/**
+	 * load the episodes from a file, whose format is detected by its header
+	 * return false if the file cannot be opened or its episodes are not all loaded, e.g., of a truncated file
+	 */
+	bool load(const std::string& path) {
+		if (episode_archive::detect(path)) {
+			episode_reader in;
+			if (!in.open(path)) return false;
+			size_t loaded = data.size();
+			for (data.emplace_back(); in.read(data.back()); data.emplace_back());
+			data.pop_back();
+			loaded = data.size() - loaded;
+			total = std::max(total, data.size());
+			count = data.size();
+			rebuild();
+			return !in.is_broken() && (!in.has_index() || loaded == in.size());
+		}
+		return load_text(path);
+	}
+
+	/**
+	 * load the episodes of a file in the text format, which is the same as operator >> but in parallel,
+	 * i.e., the file is memory-mapped and split into parts at the line boundaries, and the parts are parsed
+	 * by the threads in place (see episode::parse)
+	 * return false if the file cannot be opened or has a line which is not an episode, where the episodes before
+	 * the line are still loaded
+	 */
+	bool load_text(const std::string& path, size_t threads = std::thread::hardware_concurrency()) {
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) return false;
+		struct stat st;
+		size_t length = ::fstat(fd, &st) == 0 ? st.st_size : 0;
+		void* mapped = length ? ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+		::close(fd);
+		const char* text = mapped != MAP_FAILED ? static_cast<const char*>(mapped) : "";
+		if (mapped == MAP_FAILED) length = 0;
+
+		threads = std::max<size_t>(std::min<size_t>(threads, length >> 16), 1); // at least 64K per thread
+		std::vector<const char*> bound(threads + 1, text + length);
+		bound[0] = text;
+		for (size_t i = 1; i < threads; i++) {
+			const char* p = text + length * i / threads;
+			const char* eol = static_cast<const char*>(std::memchr(p, '\n', text + length - p));
+			bound[i] = std::max(eol ? eol + 1 : text + length, bound[i - 1]);
+		}
+
+		// an empty line ends the episodes, as the operator >> does, so a part also reports whether it ends early,
+		// i.e., 1 by an empty line, or 2 by a line which is not an episode
+		std::vector<std::vector<episode>> parts(threads);
+		std::vector<char> stopped(threads, 0);
+		auto work = [&](size_t i) {
+			for (const char* p = bound[i]; p < bound[i + 1]; ) {
+				const char* eol = static_cast<const char*>(std::memchr(p, '\n', bound[i + 1] - p));
+				if (!eol) eol = bound[i + 1];
+				if (eol == p) {
+					stopped[i] = 1;
+					break;
+				}
+				parts[i].emplace_back();
+				if (!parts[i].back().parse(p, eol)) {
+					parts[i].pop_back();
+					stopped[i] = 2;
+					break;
+				}
+				p = eol + 1;
+			}
+		};
+		std::vector<std::thread> workers;
+		for (size_t i = 1; i < threads; i++) workers.emplace_back(work, i);
+		work(0);
+		for (std::thread& worker : workers) worker.join();
+		if (mapped != MAP_FAILED) ::munmap(mapped, length);
+
+		bool valid = true;
+		for (size_t i = 0; i < threads; i++) {
+			data.insert(data.end(), std::make_move_iterator(parts[i].begin()), std::make_move_iterator(parts[i].end()));
+			if (stopped[i]) {
+				valid = stopped[i] != 2;
+				break;
+			}
+		}
+		total = std::max(total, data.size());
+		count = data.size();
+		rebuild();
+		return valid;
+	}
+
+private:
+	/**
+	 * the compact summary of a closed episode
+	 */
+	struct digest {
+		uint32_t black_ops;
+		uint32_t white_ops;
+		uint32_t black_playouts;
+		uint32_t white_playouts;
+		time_t time;
+		time_t black_time;
+		time_t white_time;
+		bool black_win;
+	};
+
+	/**
+	 * the sums of the digests of some games
+	 */
+	struct aggregate {
+		size_t games, black_wins;
+		size_t ops, black_ops, white_ops;
+		size_t black_playouts, white_playouts;
+		time_t time, black_time, white_time;
+
+		void add(const digest& d, int sign = 1) {
+			games += sign;
+			black_wins += sign * d.black_win;
+			ops += sign * size_t(d.black_ops + d.white_ops);
+			black_ops += sign * size_t(d.black_ops);
+			white_ops += sign * size_t(d.white_ops);
+			black_playouts += sign * size_t(d.black_playouts);
+			white_playouts += sign * size_t(d.white_playouts);
+			time += sign * d.time;
+			black_time += sign * d.black_time;
+			white_time += sign * d.white_time;
+		}
+	};
+
+	void show(const aggregate& sum) const {
+		size_t blk = sum.games;
+		std::cout << count << "\t";
+		std::cout << "win = " << (sum.black_wins * 100.0 / blk) << "%"
+		          <<      "|" << ((blk - sum.black_wins) * 100.0 / blk) << "%, ";
+		std::cout << "op = "  << (sum.ops * 1.0 / blk)
+		          <<     " (" << (sum.black_ops * 1.0 / blk)
+		          <<      "|" << (sum.white_ops * 1.0 / blk) << "), ";
+		std::cout << "ops = " << (sum.ops * 1000000.0 / sum.time)
+		          <<     " (" << (sum.black_ops * 1000000.0 / sum.black_time)
+		          <<      "|" << (sum.white_ops * 1000000.0 / sum.white_time) << ")";
+		if (sum.black_playouts + sum.white_playouts) {
+			std::cout << ", ";
+			std::cout << "pps = " << ((sum.black_playouts + sum.white_playouts) * 1000000.0 / sum.time)
+			          <<     " (" << (sum.black_playouts * 1000000.0 / sum.black_time)
+			          <<      "|" << (sum.white_playouts * 1000000.0 / sum.white_time) << ")";
+		}
+		std::cout << std::endl;
+	}
+
+	/**
+	 * maintain the aggregates with a closed episode, where the window of the last 'block' games is a ring buffer
+	 * of the digests, which grows up to 'block' entries and is independent of the saved records
+	 */
+	void accumulate(const episode& ep) {
+		digest d;
+		d.black_ops = ep.step(action::black::type);
+		d.white_ops = ep.step(action::white::type);
+		d.black_playouts = ep.playouts(action::black::type);
+		d.white_playouts = ep.playouts(action::white::type);
+		d.time = ep.time();
+		d.black_time = ep.time(action::black::type);
+		d.white_time = ep.time(action::white::type);
+		d.black_win = ep.ep_moves.size() % 2 == 1;
+		if (ring.size() < block) {
+			ring.push_back(d);
+			window.add(d);
+		} else if (block) { // a statistic of no game has no window
+			size_t slot = overall.games % block;
+			window.add(ring[slot], -1);
+			ring[slot] = d;
+			window.add(d);
+		}
+		overall.add(d);
+	}
+
+	void rebuild() {
+		ring.clear();
+		window = {};
+		overall = {};
+		for (const episode& rec : data) accumulate(rec);
+	}
+
 private:
 	size_t total;
 	size_t block;
 	size_t limit;
 	size_t count;
-	std::list<episode> data;
+	std::deque<episode> data;
+	std::vector<digest> ring;
+	aggregate window;
+	aggregate overall;
 };